@@ -1,4 +1,5 @@
 ﻿#include "CudaKernel.cuh"
+#include "Traversal.cuh"
 #include <helper_cuda.h>
 #include <iostream>
 #include <math_functions.hpp>
@@ -7,187 +8,82 @@ namespace CudaSpace
 {
 	__device__ bool use_color_map = false;
 	__device__ float max_height = 0;
-	__device__ float *point_buffer;
-	__device__ int *LOD_indexes, *LOD_resolutions;
-	__device__ CudaSpace::Color *color_map;
-	__device__ int LOD_levels, stride_x = 1;
+	__device__ float pixel_footprint = 0; // Width of a pixel in grid cells at unit distance from the camera
+	__device__ GridPyramid grids[max_grids]; // Traversed in order, the first one is the point buffer around the camera
+	__device__ int grid_count = 0;
 	__device__ glm::vec3 *frame_dimension;
 	__device__ glm::vec3 *camera_forward;
-	__device__ glm::vec3 *grid_camera_position;
+	__device__ glm::vec3 *camera_position;
 	__device__ glm::ivec2 *texture_resolution;
-	__device__ glm::ivec2 *point_buffer_resolution;
-	__device__ glm::ivec2 *boundary;
 	__device__ glm::mat3x3 *pixel_to_grid_matrix;
+	__device__ HeatmapMode heatmap_mode = HeatmapMode::Off;
+	__device__ TraversalStatistics traversal_statistics;
 
-	/*
-	* Get a colormap value from a height map index
-	*/
-	__device__ void getColorMapValue(int posX, int posZ, bool mirrorX, bool mirrorZ, Color& result)
-	{
-		if (mirrorX)
-			posX = LOD_resolutions[0] - 1 - posX;
-		if (mirrorZ)
-			posZ = LOD_resolutions[0] - 1 - posZ;
-
-		result = color_map[posX + posZ * LOD_resolutions[0]];
-	}
+	const int heatmap_max_iterations = iteration_histogram_bins * iteration_histogram_width; // Iterations shown at full heat
+	const int heatmap_max_steps = 32; // LOD descents or ascents shown at full heat
 
 	/*
-	* Get a value based on max height
+	* Map a value between 0 and 1 to a blue, cyan, green, yellow, red ramp
 	*/
-	__device__ void getHeightColorValue(float height, Color& result)
+	__device__ void getHeatmapColorValue(float value, Color& result)
 	{
-		unsigned char r, g, b;
-		height = height * 2 / max_height ;
-		if(height > 1)
-		{
-			height -= 1;
-			r = 255;
-			g = 255 - height * 255;
-			b = 0;
-		}
-		else
+		value = glm::clamp(value, 0.f, 1.f) * 4;
+		int segment = glm::min(static_cast<int>(value), 3);
+		unsigned char rising = static_cast<unsigned char>((value - segment) * 255), falling = 255 - rising;
+		switch (segment)
 		{
-			r = 255 * height;
-			g = r;
-			b = 255 - height * 255;
+		case 0: result = Color(static_cast<unsigned char>(0), rising, static_cast<unsigned char>(255)); break;
+		case 1: result = Color(static_cast<unsigned char>(0), static_cast<unsigned char>(255), falling); break;
+		case 2: result = Color(rising, static_cast<unsigned char>(255), static_cast<unsigned char>(0)); break;
+		default: result = Color(static_cast<unsigned char>(255), falling, static_cast<unsigned char>(0));
 		}
-		result = Color(r, g, b);
 	}
 
 	/*
-	 * Retrieve the height value from point buffer based on LOD and position
-	 */
-	__device__ float getPointBufferValue(int posX, int posZ, bool mirrorX, bool mirrorZ, int LOD)
-	{
-		if (mirrorX)
-			posX = LOD_resolutions[LOD] - 1 - posX;
-		if (mirrorZ)
-			posZ = LOD_resolutions[LOD] - 1 - posZ;
-
-		return point_buffer[LOD_indexes[LOD] + posX + posZ * LOD_resolutions[LOD]];
-	}
-
-	/*
-	 *Calculate exit point based on current ray position
-	 */
-	__device__ void calculateExitPointAndEdge(glm::vec3& entry, glm::vec3& direction, glm::vec3& exit, int &edge, int LOD)
+	* Replace the color of a ray with the heat of the traversal quantity of the current heatmap mode
+	* Rays that hit nothing are black in the final LOD mode
+	*/
+	__device__ void getTraversalHeatmapValue(TraversalCounters const& counters, Color& result)
 	{
-		float tX, tZ;
-		tX = ((floor(entry.x / pow(2.f, LOD)) + 1) * pow(2.f, LOD) - entry.x) / direction.x;
-		tZ = ((floor(entry.z / pow(2.f, LOD)) + 1) * pow(2.f, LOD) - entry.z) / direction.z;
-		if(tX <= tZ)
+		switch (heatmap_mode)
 		{
-			exit = entry + tX * direction;
-			exit.x = (floor(entry.x / pow(2.f, LOD)) + 1) * pow(2.f, LOD);
-			edge = floor(exit.x / pow(2.f, LOD));
-		}
-		else
-		{
-			exit = entry + tZ * direction;
-			exit.z = (floor(entry.z / pow(2.f, LOD)) + 1) * pow(2.f, LOD);
-			edge = floor(exit.z / pow(2.f, LOD));
+		case HeatmapMode::Iterations:
+			getHeatmapColorValue(counters.iterations / static_cast<float>(heatmap_max_iterations), result);
+			break;
+		case HeatmapMode::Descents:
+			getHeatmapColorValue(counters.descents / static_cast<float>(heatmap_max_steps), result);
+			break;
+		case HeatmapMode::Ascents:
+			getHeatmapColorValue(counters.ascents / static_cast<float>(heatmap_max_steps), result);
+			break;
+		case HeatmapMode::FinalLOD:
+			if (counters.grid < 0)
+				result = Color(static_cast<unsigned char>(0), static_cast<unsigned char>(0), static_cast<unsigned char>(0));
+			else
+				getHeatmapColorValue(counters.final_LOD / static_cast<float>(glm::max(grids[counters.grid].LOD_levels - 1, 1)), result);
+			break;
+		default:;
 		}
 	}
 
 	/*
-	 * Test if the ray intersects with the height field
-	 */
-	__device__ bool testIntersection(glm::vec3 &entry, glm::vec3 &exit, glm::vec3 &direction, bool mirrorX, bool mirrorZ, int &LOD)
-	{
-		bool result;
-		float height;
-
-		height = getPointBufferValue(floor(entry.x / pow(2.f, LOD)), floor(entry.z / pow(2.f, LOD)), mirrorX, mirrorZ, LOD);
-		if(direction.y >= 0)
-		{
-			result = entry.y <= height;
-		}
-		else
-		{
-			result = exit.y <= height;
-			if (result)
-				entry += glm::max(0.f, (height - entry.y) / direction.y) * direction;
-		}
-
-		return result;		
-	}
-
-
-	/*
-	 *	Dick, C., et al. (2009). GPU ray-casting for scalable terrain rendering. Proceedings of EUROGRAPHICS, Citeseer.
-	 *	ray_direction MUST be normalized
-	 */
-	__device__ void castRay(glm::vec3& ray_position, glm::vec3& ray_direction, Color& result)
+	* Add the traversal of a ray to the frame totals and histograms
+	*/
+	__device__ void recordTraversal(TraversalCounters const& counters)
 	{
-		bool mirrorX, mirrorZ;
-		glm::vec3 ray_exit;
-		int edge;
-		int LOD = LOD_levels - 1;
-		bool intersection;
-
-		/*Mirror direction to simplify algorithm*/
-		if(ray_direction.x < 0)
-		{
-			mirrorX = true;
-			ray_direction.x = -ray_direction.x;
-			ray_position.x = point_buffer_resolution->x * pow(2.f, LOD) - ray_position.x;
-		}
-		else
-		{
-			mirrorX = false;
-		}
-
-		if(ray_direction.z < 0)
-		{
-			mirrorZ = true;
-			ray_direction.z = -ray_direction.z;
-			ray_position.z = point_buffer_resolution->y * pow(2.f, LOD) - ray_position.z;
-		}
-		else
-		{
-			mirrorZ = false;
-		}
-
-		/*Advance ray until it is outside of the buffer*/
-		while(ray_position.x < boundary->x && ray_position.z < boundary->y && !(ray_direction.y > 0 && ray_position.y > max_height))
+		atomicAdd(&traversal_statistics.iterations, static_cast<unsigned long long>(counters.iterations));
+		atomicAdd(&traversal_statistics.descents, static_cast<unsigned long long>(counters.descents));
+		atomicAdd(&traversal_statistics.ascents, static_cast<unsigned long long>(counters.ascents));
+		atomicAdd(&traversal_statistics.rays, 1u);
+		atomicMax(&traversal_statistics.max_iterations, static_cast<unsigned int>(counters.iterations));
+		atomicAdd(&traversal_statistics.iteration_histogram[glm::min(counters.iterations / iteration_histogram_width, iteration_histogram_bins - 1)], 1u);
+		if (counters.grid >= 0)
 		{
-			calculateExitPointAndEdge(ray_position, ray_direction, ray_exit, edge, LOD);
-			intersection = testIntersection(ray_position, ray_exit, ray_direction, mirrorX, mirrorZ, LOD);
-			if(intersection)
-			{
-				if (LOD > 0)
-					LOD--;
-				else
-				{
-					if (use_color_map)
-						getColorMapValue(floor(ray_position.x), floor(ray_position.z), mirrorX, mirrorZ, result);
-					else
-						getHeightColorValue(ray_position.y, result);
-					return;
-				}
-				
-			}
-			else
-			{
-				LOD = glm::min(LOD + 1 - (edge % 2), LOD_levels - 1);
-				ray_position = ray_exit;			
-			}
+			atomicAdd(&traversal_statistics.hits, 1u);
+			atomicAdd(&traversal_statistics.final_LOD_histogram[counters.final_LOD], 1u);
+			atomicAdd(&traversal_statistics.grid_histogram[counters.grid], 1u);
 		}
 	}
-	
-	/*
-	 * Converts a pixel position to the grid space
-	 * Pinhole camera model - From: Realistic Ray Tracing by Peter Shirley, pages 37-42
-	 */
-	__device__ glm::vec3 viewToGridSpace(glm::ivec2 &pixel_position)
-	{
-		glm::vec3 result = glm::vec3(
-			 frame_dimension->x / 2.0f - (frame_dimension->x) * pixel_position.x / (texture_resolution->x - 1),
-			-frame_dimension->y / 2.0f + (frame_dimension->y) * pixel_position.y / (texture_resolution->y - 1),
-			-frame_dimension->z);
-		return result;
-	}
 
 	/*
 	 * Start the ray tracing algorithm for each pixel
@@ -209,11 +105,18 @@ namespace CudaSpace
 		pixel_position = glm::ivec2(pixel_x, pixel_y);
 
 		/*Calculate ray direction and cast ray*/
-		ray_direction = *pixel_to_grid_matrix * viewToGridSpace(pixel_position);
+		ray_direction = *pixel_to_grid_matrix * viewToGridSpace(pixel_position, *frame_dimension, *texture_resolution);
 
-		ray_position = ray_direction + *grid_camera_position;
+		ray_position = ray_direction + *camera_position;
 		ray_direction = normalize(ray_direction);
-		castRay(ray_position, ray_direction, color_value);
+		TraversalParameters parameters = { use_color_map, max_height, pixel_footprint, grids, grid_count };
+		TraversalCounters counters;
+		castRay(parameters, ray_position, ray_direction, color_value, counters);
+		if (heatmap_mode != HeatmapMode::Off)
+		{
+			recordTraversal(counters);
+			getTraversalHeatmapValue(counters, color_value);
+		}
 		
 		//GL_RGB
 		color_buffer[threadId * 3] = color_value.r;
@@ -224,51 +127,29 @@ namespace CudaSpace
 	/*
 	* Set device parameters
 	*/
-	__global__ void cuda_setParameters(glm::vec3 frame_dim, glm::vec3 camera_for, glm::vec3 grid_camera_pos, bool use_color, float max_height)
+	__global__ void cuda_setParameters(glm::vec3 frame_dim, glm::vec3 camera_for, glm::vec3 camera_pos, bool use_color, float max_height, HeatmapMode heatmap)
 	{
+		heatmap_mode = heatmap;
 		*frame_dimension = frame_dim;
-		*grid_camera_position = grid_camera_pos;
+		*camera_position = camera_pos;
 		use_color_map = use_color;
 		CudaSpace::max_height = max_height;
+		pixel_footprint = frame_dim.x / texture_resolution->x / frame_dim.z;
 
-		/*Basis change matrix from view to grid space*/
-		glm::vec3 u, v, w;
-		w = -camera_for;
-		u = glm::normalize(glm::cross(glm::vec3(0, 100, 0), w));
-		v = glm::cross(w, u);
-		*pixel_to_grid_matrix = glm::mat3x3(u,v,w);
+		*pixel_to_grid_matrix = viewToGridMatrix(camera_for);
 	}
 
 	/* 
 	 * Initialize device 
 	 */
-	__global__ void cuda_initializeDeviceVariables(glm::ivec2 point_buffer_resolution, glm::ivec2 texture_resolution, float* point_buffer, CudaSpace::Color *color_map, int LOD_levels, int stride_x, float max_height)
+	__global__ void cuda_initializeDeviceVariables(glm::ivec2 texture_resolution)
 	{
 		CudaSpace::texture_resolution = new glm::ivec2();
-		CudaSpace::point_buffer_resolution = new glm::ivec2();
-
-		LOD_indexes = new int[LOD_levels]();
-		LOD_resolutions = new int[LOD_levels]();
-		LOD_resolutions[LOD_levels - 1] = point_buffer_resolution.x;
-		LOD_indexes[LOD_levels - 1] = 0;
-		for(auto i = LOD_levels - 2; i >= 0; i--)
-		{
-			LOD_indexes[i] = LOD_indexes[i + 1] + LOD_resolutions[i + 1] * LOD_resolutions[i + 1];
-			LOD_resolutions[i] = LOD_resolutions[i + 1] * 2;
-		}
-
-		boundary = new glm::ivec2(LOD_resolutions[0], LOD_resolutions[0]);
 		frame_dimension = new glm::vec3();
 		pixel_to_grid_matrix = new glm::mat3x3();
-		grid_camera_position = new glm::vec3();
+		camera_position = new glm::vec3();
 
-		*CudaSpace::point_buffer_resolution = point_buffer_resolution;
 		*CudaSpace::texture_resolution = texture_resolution;
-		CudaSpace::point_buffer = point_buffer;
-		CudaSpace::color_map = color_map;
-		CudaSpace::LOD_levels = LOD_levels;
-		CudaSpace::stride_x = stride_x;
-		CudaSpace::max_height = max_height;
 	}
 
 	/*
@@ -276,19 +157,17 @@ namespace CudaSpace
 	*/
 	__global__ void cuda_freeDeviceVariables()
 	{
-		delete(grid_camera_position);
+		delete(camera_position);
 		delete(texture_resolution);
 		delete(frame_dimension);
 		delete(pixel_to_grid_matrix);
-		delete(point_buffer_resolution);
-		delete[](LOD_indexes);
-		delete[](LOD_resolutions);
 	}
 
 	/*
 	 * Set grid and block dimensions, create LOD, pass parameters to device and call kernels
 	 */
-	__host__ void rayTrace(glm::ivec2& texture_resolution, glm::vec3& frame_dimensions, glm::vec3& camera_forward, glm::vec3& grid_camera_pos, unsigned char* color_buffer, bool use_color_map, float max_height)
+	__host__ void rayTrace(glm::ivec2& texture_resolution, glm::vec3& frame_dimensions, glm::vec3& camera_forward, glm::vec3& camera_pos, unsigned char* color_buffer, bool use_color_map, float max_height, GridPyramid* grids, int grid_count,
+		HeatmapMode heatmap_mode, TraversalStatistics* statistics)
 	{
 		/*
 		 *  Things to consider:
@@ -297,7 +176,14 @@ namespace CudaSpace
 		 *  Maximum number of threads per block
 		 */
 		dim3 gridSize, blockSize;
-		cuda_setParameters << <1, 1 >> > (frame_dimensions, camera_forward, grid_camera_pos, use_color_map, max_height);
+		checkCudaErrors(cudaMemcpyToSymbol(CudaSpace::grids, grids, sizeof(GridPyramid) * grid_count));
+		checkCudaErrors(cudaMemcpyToSymbol(CudaSpace::grid_count, &grid_count, sizeof(int)));
+		cuda_setParameters << <1, 1 >> > (frame_dimensions, camera_forward, camera_pos, use_color_map, max_height, heatmap_mode);
+		if (heatmap_mode != HeatmapMode::Off)
+		{
+			TraversalStatistics cleared = {};
+			checkCudaErrors(cudaMemcpyToSymbol(CudaSpace::traversal_statistics, &cleared, sizeof(TraversalStatistics)));
+		}
 		checkCudaErrors(cudaDeviceSynchronize());
 		
 		blockSize = dim3(1, texture_resolution.y/2);
@@ -305,14 +191,16 @@ namespace CudaSpace
 		gridSize = dim3(texture_resolution.x / blockSize.x, texture_resolution.y / blockSize.y);
 		cuda_rayTrace << <gridSize, blockSize >> > (color_buffer);
 		checkCudaErrors(cudaDeviceSynchronize());
+		if (heatmap_mode != HeatmapMode::Off && statistics != nullptr)
+			checkCudaErrors(cudaMemcpyFromSymbol(statistics, CudaSpace::traversal_statistics, sizeof(TraversalStatistics)));
 	}
 
 	/*
 	 * Initialize variables in the device
 	 */
-	__host__ void initializeDeviceVariables(glm::ivec2& point_buffer_res, glm::ivec2& texture_res, float* d_gpu_pointBuffer, CudaSpace::Color* d_color_map, int LOD_levels, int stride_x, float max_height)
+	__host__ void initializeDeviceVariables(glm::ivec2& texture_res)
 	{
-		cuda_initializeDeviceVariables << <1, 1 >> > (point_buffer_res, texture_res, d_gpu_pointBuffer, d_color_map, LOD_levels, stride_x, max_height);
+		cuda_initializeDeviceVariables << <1, 1 >> > (texture_res);
 		checkCudaErrors(cudaDeviceSynchronize());
 	}
 
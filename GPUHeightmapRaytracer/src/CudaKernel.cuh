@@ -46,7 +46,85 @@ namespace CudaSpace
 		}
 		unsigned char r, g, b;
 	};
-	__host__ void rayTrace(glm::ivec2& texture_resolution, glm::vec3& frame_dimensions, glm::vec3& camera_forward, glm::vec3& grid_camera_position, unsigned char* colorBuffer, bool use_color, float max_height);
-	__host__ void initializeDeviceVariables(glm::ivec2& point_buffer_res, glm::ivec2& texture_res, float* d_gpu_pointBuffer, CudaSpace::Color* d_color_map, int LOD_levels, int stride_x, float max_height);
+
+	/*
+	 * Compact color storage used by the sections and the color map
+	 * RGB555 below an occupied bit by default, 32-bit aligned RGBA with an opaque alpha as the occupied byte when COLOR_STORAGE_RGBA8 is defined
+	 * A packed value of 0 marks a cell without points, every packed color has its occupied bits set
+	 */
+#ifdef COLOR_STORAGE_RGBA8
+	typedef unsigned int PackedColor;
+	const int packed_color_format = 2; // Stored with cached packed colors so that a cache of the other layout is rebuilt
+
+	__device__ __host__ inline PackedColor packColor(Color const& c)
+	{
+		return 0xFF000000u | c.b << 16 | c.g << 8 | c.r;
+	}
+
+	__device__ __host__ inline Color unpackColor(PackedColor p)
+	{
+		return Color(static_cast<unsigned char>(p & 0xFF), static_cast<unsigned char>(p >> 8 & 0xFF), static_cast<unsigned char>(p >> 16 & 0xFF));
+	}
+#else
+	typedef unsigned short PackedColor;
+	const int packed_color_format = 1; // Stored with cached packed colors so that a cache of the other layout is rebuilt
+
+	__device__ __host__ inline PackedColor packColor(Color const& c)
+	{
+		return static_cast<PackedColor>(0x8000 | (c.r >> 3) << 10 | (c.g >> 3) << 5 | c.b >> 3);
+	}
+
+	__device__ __host__ inline Color unpackColor(PackedColor p)
+	{
+		/*Replicate the high bits in the low bits to map full intensity back to 255*/
+		unsigned char r = p >> 10 & 0x1F, g = p >> 5 & 0x1F, b = p & 0x1F;
+		return Color(static_cast<unsigned char>(r << 3 | r >> 2), static_cast<unsigned char>(g << 3 | g >> 2), static_cast<unsigned char>(b << 3 | b >> 2));
+	}
+#endif
+
+	const int max_LOD_levels = 16;
+	const int max_grids = 8;
+
+	/*
+	 * A max height pyramid traversed by the rays, stored like a point section: coarsest level first
+	 * Positions are given in dataset space (finest cells of the point sections, origin at the minimum of the cloud)
+	 * Heights of a grid are divided by its scale so that its cells stay cubic
+	 */
+	struct GridPyramid
+	{
+		float *heights;
+		PackedColor *colors;
+		int LOD_levels;
+		int LOD_indexes[max_LOD_levels];
+		int LOD_resolutions[max_LOD_levels];
+		glm::vec2 origin; // Dataset position of the first cell
+		float scale; // Size of a finest grid cell in dataset cells
+		glm::ivec4 valid_LOD; // Finest loaded LOD of the lower left, lower right, upper left and upper right sections in the grid
+		glm::ivec2 section_split; // First finest cell of the right and upper sections in the grid
+	};
+
+	/*
+	 * Traversal quantity rendered as a heatmap in place of the color, Off renders the color
+	 */
+	enum class HeatmapMode { Off, Iterations, Descents, Ascents, FinalLOD, Count };
+
+	const int iteration_histogram_bins = 32;
+	const int iteration_histogram_width = 16; // Iterations per bin, the last bin also takes every longer ray
+
+	/*
+	 * Totals and histograms of the traversal of a frame, only gathered while a heatmap is rendered
+	 */
+	struct TraversalStatistics
+	{
+		unsigned long long iterations, descents, ascents;
+		unsigned int rays, hits, max_iterations;
+		unsigned int iteration_histogram[iteration_histogram_bins];
+		unsigned int final_LOD_histogram[max_LOD_levels]; // Hits per LOD they were found at
+		unsigned int grid_histogram[max_grids]; // Hits per grid
+	};
+
+	__host__ void rayTrace(glm::ivec2& texture_resolution, glm::vec3& frame_dimensions, glm::vec3& camera_forward, glm::vec3& camera_position, unsigned char* colorBuffer, bool use_color, float max_height, GridPyramid* grids, int grid_count,
+		HeatmapMode heatmap_mode, TraversalStatistics* statistics);
+	__host__ void initializeDeviceVariables(glm::ivec2& texture_res);
 	__host__ void freeDeviceVariables();
 }
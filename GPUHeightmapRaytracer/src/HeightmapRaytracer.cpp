@@ -0,0 +1,3520 @@
+/***********************************************************
+* A Template for building OpenGL applications using GLUT
+*
+* Author: Perspective @ cprogramming.com
+* Date : Jan, 2005
+*
+* Description:
+* This code initializes an OpenGL ready window
+* using GLUT. Some of the most common callbacks
+* are registered to empty or minimal functions.
+*
+* This code is intended to be a quick starting point
+* when building GLUT applications.
+*
+* Source: http://www.cprogramming.com/snippets/source-code/a-code-template-for-opengl-divide-glut
+*
+***********************************************************/
+
+#include "HeightmapRaytracer.h"
+
+
+//============================
+//		GLOBAL VARIABLES
+//============================
+// Declared and documented in HeightmapRaytracer.h
+
+std::string point_cloud_file = "autzen.las";
+std::string color_map_file = "autzen.jpg";
+
+glm::ivec2 texture_resolution(1920, 1080);
+glm::vec3
+	camera_position(0, 0, 0),
+	camera_forward(glm::normalize(glm::vec3(0, -.9, 1))),
+	frame_dimension(16*2, 9*2, 20);
+glm::vec2 boundaries(0, 0);
+
+GLuint textureID;
+GLuint bufferID;
+bool use_LOD = false;
+bool use_color_map = false;
+CudaSpace::HeatmapMode heatmap_mode = CudaSpace::HeatmapMode::Off;
+const char* heatmap_mode_names[] = { "off", "iterations", "LOD descents", "LOD ascents", "final LOD" };
+CudaSpace::TraversalStatistics traversal_statistics = {};
+
+glm::ivec2 color_map_resolution = glm::zero<glm::ivec2>();
+
+glm::ivec2 point_buffer_resolution(32, 32);
+
+int section_ring_count = 2;
+SectionRing section_rings[max_section_rings];
+
+std::list<CachedSection> section_cache;
+std::size_t section_cache_budget = std::size_t(1) << 30;
+bool compress_cached_sections = true;
+
+std::thread* section_compressor = nullptr;
+std::mutex section_compressor_mutex;
+std::condition_variable section_compressor_wake, section_compressor_idle;
+std::deque<CachedSection*> section_compress_queue;
+CachedSection* section_compressing = nullptr;
+bool section_compressor_exit = false;
+
+std::list<PrefetchedSection> section_prefetches;
+float prefetch_horizon = 2;
+
+const char* memory_class_names[] = { "sections", "prefetch", "cache", "loaders", "cancelled", "point buffer", "color map", "overview" };
+std::atomic<long long> memory_usage[static_cast<int>(MemoryClass::Count)];
+std::size_t memory_budget = std::size_t(8) << 30;
+bool memory_over_budget = false;
+
+std::atomic<bool> tracing_enabled(false);
+std::string trace_file = "trace.json";
+const std::chrono::steady_clock::time_point trace_epoch = std::chrono::steady_clock::now();
+long long trace_session_start = 0;
+std::vector<ThreadTrace*> trace_threads;
+int trace_thread_count = 0;
+std::mutex trace_threads_mutex;
+thread_local ThreadTrace* trace_thread = nullptr;
+thread_local TraceThreadExit trace_thread_exit;
+thread_local const char* trace_thread_name = "thread";
+
+std::vector<CatalogFile> catalog;
+glm::dvec3 dataset_min, dataset_max;
+
+bool use_chipper = true;
+
+int laz_decode_workers = 4;
+
+glm::vec3 cell_size;
+float cell_size_override = 0;
+float points_per_cell = 2;
+bool progressive_loading = true;
+float max_height = 0;
+float height_tolerance = 10;
+int stride_x;
+int LOD_resolutions[LOD_levels];
+int LOD_indexes[LOD_levels];
+
+HeightAggregation height_aggregation = HeightAggregation::Max;
+
+ColorAggregation color_aggregation = ColorAggregation::HighestPoint;
+
+bool use_overview = true;
+CudaSpace::GridPyramid overview_grid;
+int overview_size;
+float* h_overview_heights;
+CudaSpace::PackedColor* h_overview_colors;
+std::thread* overview_thread;
+std::atomic<bool> overview_exit(false);
+std::atomic<bool> overview_complete(false);
+std::atomic<bool> overview_uploaded(false);
+
+CudaSpace::GridPyramid grids[CudaSpace::max_grids];
+int grid_count = 0;
+
+std::chrono::system_clock sys_clock;
+std::chrono::time_point<std::chrono::system_clock> last_frame, current_frame;
+std::chrono::duration<float> delta_time;
+
+glm::vec2 camera_velocity(0, 0);
+float camera_yaw_rate = 0;
+float movement_rht = 0;
+float movement_fwd = 0;
+float movement_up = 0;
+float right_movement = 0;
+float wasd_movement_distance = 250;
+float qe_movement_distance = 500;
+float fixed_time_step = 0;
+
+float rotation_up = 0;
+float rotation_right = 0;
+float ik_rotation_angle = 1.f;
+float jl_rotation_angle = 1.f;
+
+const char* frame_stage_names[] = { "manageSections", "preparePointBuffer", "copyPointBuffer", "updateTexture", "renderTexture", "frame" };
+StageTimes stage_times[static_cast<int>(FrameStage::Count)];
+bool show_timing_overlay = false;
+std::string timing_report_file = "frame_timing";
+
+std::vector<SectionStatistics> section_statistics;
+std::mutex section_statistics_mutex;
+std::string loader_statistics_file = "loader_statistics.csv";
+
+CameraPathMode camera_path_mode = CameraPathMode::Off;
+std::string camera_path_file = "camera_path.txt";
+std::vector<CameraPathFrame> camera_path;
+std::size_t replay_frame = 0;
+bool replay_wait_for_sections = true;
+bool replay_frame_counted = false;
+int replay_wait_frames = 0;
+std::vector<ReplayFrameTiming> replay_timings;
+std::string replay_timing_file = "replay_timing.csv";
+bool exit_after_replay = false;
+
+
+//============================
+//		CUDA VARIABLES
+//============================
+
+struct cudaGraphicsResource* cuda_pbo_resource;
+
+//============================
+//		MEMORY ACCOUNTING
+//============================
+
+/*
+ * Account allocated (positive) or freed (negative) host bytes to a class, loaders call it from their threads
+ */
+void trackMemory(MemoryClass memory_class, long long bytes)
+{
+	memory_usage[static_cast<int>(memory_class)] += bytes;
+}
+
+/*
+ * Move accounted bytes from a class to another when an allocation changes owner
+ */
+void transferMemory(MemoryClass from, MemoryClass to, long long bytes)
+{
+	trackMemory(from, -bytes);
+	trackMemory(to, bytes);
+}
+
+std::size_t totalMemory()
+{
+	long long total = 0;
+	for (int i = 0; i < static_cast<int>(MemoryClass::Count); i++)
+		total += memory_usage[i];
+	return static_cast<std::size_t>(total);
+}
+
+/*
+ * Host bytes of the height and color pyramids of a section
+ */
+std::size_t sectionBytes()
+{
+	return (sizeof(float) + sizeof(CudaSpace::PackedColor)) * stride_x * point_buffer_resolution.x * point_buffer_resolution.y;
+}
+
+/*
+ * Returns true if bytes more can be allocated without exceeding the budget
+ * Cancelled sections are about to be freed and do not count
+ */
+bool memoryAvailable(std::size_t bytes)
+{
+	std::size_t budgeted = totalMemory() - static_cast<std::size_t>(memory_usage[static_cast<int>(MemoryClass::Cancelled)]);
+	return memory_budget == 0 || budgeted + bytes <= memory_budget;
+}
+
+void printMemoryUsage()
+{
+	std::cout << "Host memory " << totalMemory() / (1 << 20) << " MiB";
+	if (memory_budget > 0)
+		std::cout << " of " << memory_budget / (1 << 20) << " MiB";
+	std::cout << std::endl;
+	for (int i = 0; i < static_cast<int>(MemoryClass::Count); i++)
+		std::cout << "  " << memory_class_names[i] << ": " << memory_usage[i] / (1 << 20) << " MiB" << std::endl;
+}
+
+//============================
+//		TRACING
+//============================
+
+long long traceTimestamp()
+{
+	return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - trace_epoch).count();
+}
+
+/*
+ * Name the calling thread in the trace, only kept until the thread records its first event
+ */
+void traceThreadName(const char* name)
+{
+	trace_thread_name = name;
+}
+
+TraceThreadExit::~TraceThreadExit()
+{
+	if (trace_thread != nullptr)
+		trace_thread->exited = true;
+}
+
+/*
+ * Free a thread's buffer, only once its thread has exited
+ */
+void freeThreadTrace(ThreadTrace* thread)
+{
+	TraceBlock* block = thread->first.next.load(std::memory_order_acquire);
+	while (block != nullptr)
+	{
+		TraceBlock* next = block->next.load(std::memory_order_acquire);
+		delete block;
+		block = next;
+	}
+	delete thread;
+}
+
+/*
+ * Append an event to the calling thread's buffer, registering the buffer on the thread's first event
+ * Only the owning thread writes a buffer, the exporter reads the events published by the counts
+ */
+void traceEvent(TraceEvent const& event)
+{
+	if (trace_thread == nullptr)
+	{
+		trace_thread = new ThreadTrace();
+		trace_thread->name = trace_thread_name;
+		trace_thread->last = &trace_thread->first;
+		/*Referencing the exit marker constructs it so that it runs when the thread ends*/
+		(void)&trace_thread_exit;
+		std::lock_guard<std::mutex> lock(trace_threads_mutex);
+		trace_thread->id = trace_thread_count++;
+		trace_threads.push_back(trace_thread);
+	}
+	TraceBlock* block = trace_thread->last;
+	std::size_t count = block->count.load(std::memory_order_relaxed);
+	if (count == trace_block_events)
+	{
+		TraceBlock* next = new TraceBlock();
+		block->next.store(next, std::memory_order_release);
+		trace_thread->last = block = next;
+		count = 0;
+	}
+	block->events[count] = event;
+	block->count.store(count + 1, std::memory_order_release);
+}
+
+/*
+ * Record a completed span, args are optional named integers
+ */
+void traceComplete(const char* name, long long start, long long duration, const char* arg_name0 = nullptr, long long arg0 = 0, const char* arg_name1 = nullptr, long long arg1 = 0)
+{
+	if (!tracing_enabled.load(std::memory_order_relaxed))
+		return;
+	traceEvent({ name, 'X', start, duration, { arg_name0, arg_name1 }, { arg0, arg1 } });
+}
+
+void traceInstant(const char* name, const char* arg_name0 = nullptr, long long arg0 = 0, const char* arg_name1 = nullptr, long long arg1 = 0)
+{
+	if (!tracing_enabled.load(std::memory_order_relaxed))
+		return;
+	traceEvent({ name, 'i', traceTimestamp(), 0, { arg_name0, arg_name1 }, { arg0, arg1 } });
+}
+
+/*
+ * Record the span from construction to destruction, the start is only read when tracing
+ * Scopes opened before tracing was enabled are not recorded
+ */
+struct ScopedTrace
+{
+	const char* name;
+	long long start; // -1 when tracing was disabled at construction
+
+	ScopedTrace(const char* name) : name(name), start(tracing_enabled.load(std::memory_order_relaxed) ? traceTimestamp() : -1) {}
+	~ScopedTrace()
+	{
+		if (start >= 0 && tracing_enabled.load(std::memory_order_relaxed))
+			traceComplete(name, start, traceTimestamp() - start);
+	}
+};
+
+/*
+ * Write the events recorded since tracing was last enabled as Chrome trace_event JSON
+ * The buffers of exited threads are freed afterwards, their events are older than any later recording
+ */
+void writeTrace()
+{
+	std::ofstream ofs(trace_file);
+	if (!ofs.is_open())
+		return;
+	ofs << "{\"traceEvents\":[" << std::endl;
+	bool first_event = true;
+	std::lock_guard<std::mutex> lock(trace_threads_mutex);
+	for (ThreadTrace* thread : trace_threads)
+	{
+		ofs << (first_event ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << thread->id << ",\"args\":{\"name\":\"" << thread->name << " " << thread->id << "\"}}";
+		first_event = false;
+		for (TraceBlock* block = &thread->first; block != nullptr; block = block->next.load(std::memory_order_acquire))
+		{
+			std::size_t count = block->count.load(std::memory_order_acquire);
+			for (std::size_t i = 0; i < count; i++)
+			{
+				TraceEvent const& event = block->events[i];
+				if (event.timestamp < trace_session_start)
+					continue;
+				ofs << ",\n{\"name\":\"" << event.name << "\",\"ph\":\"" << event.phase << "\",\"pid\":1,\"tid\":" << thread->id << ",\"ts\":" << event.timestamp;
+				if (event.phase == 'X')
+					ofs << ",\"dur\":" << event.duration;
+				else
+					ofs << ",\"s\":\"t\"";
+				if (event.arg_names[0] != nullptr)
+				{
+					ofs << ",\"args\":{\"" << event.arg_names[0] << "\":" << event.args[0];
+					if (event.arg_names[1] != nullptr)
+						ofs << ",\"" << event.arg_names[1] << "\":" << event.args[1];
+					ofs << "}";
+				}
+				ofs << "}";
+			}
+		}
+	}
+	ofs << std::endl << "]}" << std::endl;
+	std::cout << "Trace written to " << trace_file << std::endl;
+
+	auto exited = std::stable_partition(trace_threads.begin(), trace_threads.end(), [](ThreadTrace* thread) { return !thread->exited; });
+	for (auto thread = exited; thread != trace_threads.end(); ++thread)
+		freeThreadTrace(*thread);
+	trace_threads.erase(exited, trace_threads.end());
+}
+
+/*
+ * Start recording, or stop and write the trace
+ */
+void toggleTracing()
+{
+	if (!tracing_enabled)
+	{
+		trace_session_start = traceTimestamp();
+		tracing_enabled = true;
+	}
+	else
+	{
+		tracing_enabled = false;
+		writeTrace();
+	}
+}
+
+//============================
+//		LAS FUNCTIONS
+//============================
+
+/*
+ * Open a file of the data folder in binary mode, exit if it cannot be opened
+ */
+void openLASStream(std::string const& filename, std::ifstream& ifs)
+{
+	ifs.open("../Data/" + filename, std::ios::in | std::ios::binary);
+	if (!ifs.is_open())
+	{
+		std::cout << "Error opening " + filename << std::endl;
+		exit(1);
+	}
+}
+
+/*
+ * Size and last write time of a file of the data folder, returns false if it does not exist
+ */
+bool fileStamp(std::string const& filename, unsigned long long& size, unsigned long long& modified)
+{
+	WIN32_FILE_ATTRIBUTE_DATA data;
+	if (!GetFileAttributesExA(("../Data/" + filename).c_str(), GetFileExInfoStandard, &data))
+		return false;
+	size = static_cast<unsigned long long>(data.nFileSizeHigh) << 32 | data.nFileSizeLow;
+	modified = static_cast<unsigned long long>(data.ftLastWriteTime.dwHighDateTime) << 32 | data.ftLastWriteTime.dwLowDateTime;
+	return true;
+}
+
+/*
+ * Names of the LAS and LAZ files of a directory of the data folder, sorted
+ */
+std::vector<std::string> listLASFiles(std::string const& directory)
+{
+	std::vector<std::string> files;
+	WIN32_FIND_DATAA data;
+	HANDLE find = FindFirstFileA(("../Data/" + directory + "/*").c_str(), &data);
+	if (find == INVALID_HANDLE_VALUE)
+		return files;
+	do
+	{
+		std::string name = data.cFileName;
+		if ((data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) || name.size() <= 4)
+			continue;
+		std::string extension = name.substr(name.size() - 4);
+		for (char& c : extension)
+			c = static_cast<char>(tolower(c));
+		if (extension == ".las" || extension == ".laz")
+			files.push_back(name);
+	} while (FindNextFileA(find, &data));
+	FindClose(find);
+	std::sort(files.begin(), files.end());
+	return files;
+}
+
+/*
+ * Read the header of a file of the data folder into a catalog entry, its points are not touched
+ */
+CatalogFile readCatalogFile(std::string const& filename)
+{
+	std::ifstream ifs;
+	openLASStream(filename, ifs);
+	liblas::ReaderFactory f;
+	liblas::Reader reader = f.CreateWithStream(ifs);
+	liblas::Header const& header = reader.GetHeader();
+
+	CatalogFile file;
+	file.filename = filename;
+	fileStamp(filename, file.file_size, file.modified);
+	file.min = glm::dvec3(header.GetMinX(), header.GetMinY(), header.GetMinZ());
+	file.max = glm::dvec3(header.GetMaxX(), header.GetMaxY(), header.GetMaxZ());
+	file.point_count = header.GetPointRecordsCount();
+	file.compressed = header.Compressed();
+	file.point_format = static_cast<int>(header.GetDataFormatId());
+	ifs.seekg(0, std::ios::end);
+	file.point_bytes = file.point_count > 0 ? (static_cast<double>(ifs.tellg()) - header.GetDataOffset()) / file.point_count : header.GetDataRecordLength();
+	ifs.close();
+	return file;
+}
+
+/*
+ * Read the entries of the catalog index of a directory, empty if it is missing
+ */
+std::vector<CatalogFile> loadCatalogIndex(std::string const& directory)
+{
+	std::vector<CatalogFile> entries;
+	std::ifstream ifs("../Data/" + directory + "/" + catalog_index_file);
+	CatalogFile file;
+	std::string name;
+	while (ifs >> std::quoted(name) >> file.file_size >> file.modified >> file.min.x >> file.min.y >> file.min.z >> file.max.x >> file.max.y >> file.max.z
+		>> file.point_count >> file.compressed >> file.point_format >> file.point_bytes)
+	{
+		file.filename = directory + "/" + name;
+		entries.push_back(file);
+	}
+	return entries;
+}
+
+/*
+ * Write the catalog index of a directory, one file per line with its quoted name, its stamp and its header bounds
+ */
+void saveCatalogIndex(std::string const& directory)
+{
+	std::ofstream ofs("../Data/" + directory + "/" + catalog_index_file);
+	if (!ofs.is_open())
+		return;
+	ofs.precision(17);
+	for (CatalogFile const& file : catalog)
+		ofs << std::quoted(file.filename.substr(directory.size() + 1)) << " " << file.file_size << " " << file.modified << " "
+			<< file.min.x << " " << file.min.y << " " << file.min.z << " " << file.max.x << " " << file.max.y << " " << file.max.z << " "
+			<< file.point_count << " " << file.compressed << " " << file.point_format << " " << file.point_bytes << std::endl;
+}
+
+/*
+ * Catalog the dataset, a single file or a directory of tiles
+ * The headers of a directory are kept in its index, later runs only read the headers of the files whose size or write time changed
+ */
+void buildCatalog(std::string const& name)
+{
+	catalog.clear();
+	DWORD attributes = GetFileAttributesA(("../Data/" + name).c_str());
+	if (attributes != INVALID_FILE_ATTRIBUTES && (attributes & FILE_ATTRIBUTE_DIRECTORY))
+	{
+		std::vector<std::string> files = listLASFiles(name);
+		std::vector<CatalogFile> entries = loadCatalogIndex(name);
+		bool changed = entries.size() != files.size();
+		for (std::string const& file : files)
+		{
+			unsigned long long size = 0, modified = 0;
+			fileStamp(name + "/" + file, size, modified);
+			auto entry = std::find_if(entries.begin(), entries.end(), [&](CatalogFile const& e) { return e.filename == name + "/" + file; });
+			if (entry != entries.end() && entry->file_size == size && entry->modified == modified)
+				catalog.push_back(*entry);
+			else
+			{
+				catalog.push_back(readCatalogFile(name + "/" + file));
+				changed = true;
+			}
+		}
+		if (changed)
+			saveCatalogIndex(name);
+	}
+	else
+		catalog.push_back(readCatalogFile(name));
+
+	if (catalog.empty())
+	{
+		std::cout << "No LAS files in " + name << std::endl;
+		exit(1);
+	}
+	dataset_min = catalog[0].min;
+	dataset_max = catalog[0].max;
+	for (CatalogFile const& file : catalog)
+	{
+		dataset_min = glm::min(dataset_min, file.min);
+		dataset_max = glm::max(dataset_max, file.max);
+	}
+}
+
+/*
+ * Indices of the catalog files overlapping a rectangle given in finest cells of the dataset
+ */
+std::vector<int> catalogFilesOverlapping(glm::vec2 min, glm::vec2 max)
+{
+	std::vector<int> files;
+	for (int i = 0; i < static_cast<int>(catalog.size()); i++)
+	{
+		glm::vec2 file_min = glm::vec2((catalog[i].min.x - dataset_min.x) / cell_size.x, (catalog[i].min.y - dataset_min.y) / cell_size.y);
+		glm::vec2 file_max = glm::vec2((catalog[i].max.x - dataset_min.x) / cell_size.x, (catalog[i].max.y - dataset_min.y) / cell_size.y);
+		if (file_max.x >= min.x && file_min.x < max.x && file_max.y >= min.y && file_min.y < max.y)
+			files.push_back(i);
+	}
+	return files;
+}
+
+/*
+ * Load the chipper blocks of a catalog file from the cache next to it, returns false if it is missing or outdated
+ */
+bool loadChips(CatalogFile& file)
+{
+	std::ifstream ifs("../Data/" + file.filename + chips_file_extension, std::ios::in | std::ios::binary);
+	if (!ifs.is_open())
+		return false;
+	unsigned long long size = 0, modified = 0;
+	unsigned int point_count = 0, block_count = 0;
+	ifs.read(reinterpret_cast<char*>(&size), sizeof(size));
+	ifs.read(reinterpret_cast<char*>(&modified), sizeof(modified));
+	ifs.read(reinterpret_cast<char*>(&point_count), sizeof(point_count));
+	ifs.read(reinterpret_cast<char*>(&block_count), sizeof(block_count));
+	if (!ifs || size != file.file_size || modified != file.modified || point_count != file.point_count)
+		return false;
+	file.chips.resize(block_count);
+	for (ChipBlock& block : file.chips)
+	{
+		unsigned int id_count = 0;
+		ifs.read(reinterpret_cast<char*>(&block.min), sizeof(block.min));
+		ifs.read(reinterpret_cast<char*>(&block.max), sizeof(block.max));
+		ifs.read(reinterpret_cast<char*>(&id_count), sizeof(id_count));
+		block.ids.resize(id_count);
+		ifs.read(reinterpret_cast<char*>(block.ids.data()), sizeof(unsigned int) * id_count);
+	}
+	if (!ifs)
+	{
+		file.chips.clear();
+		return false;
+	}
+	return true;
+}
+
+/*
+ * Partition a catalog file into chipper blocks of at most chip_block_size points and cache them next to the file
+ * The ids of a block are sorted so that it is read front to back
+ */
+void buildChips(CatalogFile& file)
+{
+	std::ifstream ifs;
+	openLASStream(file.filename, ifs);
+	liblas::ReaderFactory f;
+	liblas::Reader reader = f.CreateWithStream(ifs);
+	liblas::chipper::Chipper chipper(&reader, chip_block_size);
+	chipper.Chip();
+	file.chips.resize(chipper.GetBlockCount());
+	for (std::size_t i = 0; i < file.chips.size(); i++)
+	{
+		liblas::chipper::Block const& block = chipper.GetBlock(i);
+		file.chips[i].min = glm::dvec2(block.GetBounds().minx(), block.GetBounds().miny());
+		file.chips[i].max = glm::dvec2(block.GetBounds().maxx(), block.GetBounds().maxy());
+		file.chips[i].ids = block.GetIDs();
+		std::sort(file.chips[i].ids.begin(), file.chips[i].ids.end());
+	}
+	ifs.close();
+
+	std::ofstream ofs("../Data/" + file.filename + chips_file_extension, std::ios::out | std::ios::binary);
+	if (!ofs.is_open())
+		return;
+	unsigned int block_count = static_cast<unsigned int>(file.chips.size());
+	ofs.write(reinterpret_cast<char const*>(&file.file_size), sizeof(file.file_size));
+	ofs.write(reinterpret_cast<char const*>(&file.modified), sizeof(file.modified));
+	ofs.write(reinterpret_cast<char const*>(&file.point_count), sizeof(file.point_count));
+	ofs.write(reinterpret_cast<char const*>(&block_count), sizeof(block_count));
+	for (ChipBlock const& block : file.chips)
+	{
+		unsigned int id_count = static_cast<unsigned int>(block.ids.size());
+		ofs.write(reinterpret_cast<char const*>(&block.min), sizeof(block.min));
+		ofs.write(reinterpret_cast<char const*>(&block.max), sizeof(block.max));
+		ofs.write(reinterpret_cast<char const*>(&id_count), sizeof(id_count));
+		ofs.write(reinterpret_cast<char const*>(block.ids.data()), sizeof(unsigned int) * id_count);
+	}
+}
+
+/*
+ * Chipper blocks of a catalog file overlapping a rectangle given in finest cells of the dataset
+ * The blocks of a file are loaded or built by the first loader that needs them, loaders of other files do not wait for it
+ */
+std::vector<ChipBlock const*> catalogBlocksOverlapping(int file, glm::vec2 min, glm::vec2 max)
+{
+	{
+		std::lock_guard<std::mutex> lock(*catalog[file].chips_mutex);
+		if (!catalog[file].chipped)
+		{
+			if (!loadChips(catalog[file]))
+				buildChips(catalog[file]);
+			catalog[file].chipped = true;
+		}
+	}
+
+	glm::dvec2 dataset_min_xy(dataset_min.x, dataset_min.y), cell_xy(cell_size.x, cell_size.y);
+	glm::dvec2 rect_min = dataset_min_xy + glm::dvec2(min) * cell_xy, rect_max = dataset_min_xy + glm::dvec2(max) * cell_xy;
+	std::vector<ChipBlock const*> blocks;
+	for (ChipBlock const& block : catalog[file].chips)
+		if (block.max.x >= rect_min.x && block.min.x < rect_max.x && block.max.y >= rect_min.y && block.min.y < rect_max.y)
+			blocks.push_back(&block);
+	return blocks;
+}
+
+/*
+ * Read the point with the given id, short gaps are read through instead of seeking
+ * position is the id of the point the reader returns next without seeking
+ */
+bool readPointId(liblas::Reader& reader, std::size_t id, std::size_t& position)
+{
+	while (position < id && id - position <= max_read_through && reader.ReadNextPoint())
+		position++;
+	if (position != id && !reader.Seek(id))
+		return false;
+	position = id + 1;
+	return reader.ReadNextPoint();
+}
+
+/*
+ * Derive the cell size from the point density so that a finest cell holds about points_per_cell points
+ * The area comes from the header extent, refined by the fraction of a coarse histogram hit by a strided sample of points
+ */
+float estimateCellSize(liblas::Reader& reader, liblas::Header const& header)
+{
+	double deltaX = header.GetMaxX() - header.GetMinX(), deltaY = header.GetMaxY() - header.GetMinY();
+	unsigned int count = header.GetPointRecordsCount();
+	if (count == 0 || deltaX <= 0 || deltaY <= 0)
+		return 2.0f;
+
+	/*Sample evenly spaced points and count the occupied histogram bins*/
+	std::vector<bool> occupied(density_histogram_size * density_histogram_size, false);
+	unsigned int samples = glm::min(count, static_cast<unsigned int>(density_sample_points));
+	unsigned int stride = count / samples;
+	int occupied_bins = 0;
+	for (unsigned int i = 0; i < samples; i++)
+	{
+		if (!reader.Seek(i * stride) || !reader.ReadNextPoint())
+			break;
+		liblas::Point const& p = reader.GetPoint();
+		int binX = glm::clamp(static_cast<int>((p.GetX() - header.GetMinX()) / deltaX * density_histogram_size), 0, density_histogram_size - 1);
+		int binY = glm::clamp(static_cast<int>((p.GetY() - header.GetMinY()) / deltaY * density_histogram_size), 0, density_histogram_size - 1);
+		if (!occupied[binX + binY * density_histogram_size])
+		{
+			occupied[binX + binY * density_histogram_size] = true;
+			occupied_bins++;
+		}
+	}
+
+	/*Fall back to the whole extent if the sample could not be read*/
+	double occupied_area = deltaX * deltaY;
+	if (occupied_bins > 0)
+		occupied_area *= occupied_bins / static_cast<double>(density_histogram_size * density_histogram_size);
+
+	return static_cast<float>(glm::sqrt(points_per_cell * occupied_area / count));
+}
+
+/*
+ * Catalog the dataset and read the LAS header of its largest file before starting the ray tracing and collect necessary information
+ * Set the camera position to the first point of that file
+ * Source: http://www.liblas.org/tutorial/cpp.html
+ */
+void readLASHeader(std::string filename)
+{
+	buildCatalog(filename);
+	CatalogFile const* largest = &catalog[0];
+	unsigned long long total_points = 0;
+	for (CatalogFile const& file : catalog)
+	{
+		total_points += file.point_count;
+		if (file.point_count > largest->point_count)
+			largest = &file;
+	}
+
+	/*Create input stream and associate it with .las file opened to read in binary mode*/
+	std::ifstream ifs;
+	openLASStream(largest->filename, ifs);
+
+	/*Create a ReaderFactory and instantiate a new liblas::Reader using the stream.*/
+	liblas::ReaderFactory f;
+	liblas::Reader reader = f.CreateWithStream(ifs);
+
+	/*After the reader has been created, you can access members of the Public Header Block*/
+	liblas::Header const& header = reader.GetHeader();
+	std::cout << "LAS File Loaded: " << largest->filename << std::endl;
+	std::cout << "Compressed: " << (header.Compressed() == true) << std::endl;
+	std::cout << "Points count: " << header.GetPointRecordsCount() << std::endl;
+	std::cout << "ScaleX: " << header.GetScaleX() << " ScaleY: " << header.GetScaleY() << " ScaleZ: " << header.GetScaleZ() << std::endl;
+	std::cout << "OffsetX: " << header.GetOffsetX() << " OffsetY: " << header.GetOffsetY() << " OffsetZ: " << header.GetOffsetZ() << std::endl;
+	std::cout << "Dataset files: " << catalog.size() << " Points count: " << total_points << std::endl;
+	std::cout << "MinX: " << dataset_min.x << " MinY: " << dataset_min.y << " MinZ: " << dataset_min.z << std::endl;
+	std::cout << "MaxX: " << dataset_max.x << " MaxY: " << dataset_max.y << " MaxZ: " << dataset_max.z << std::endl;
+	double deltaX, deltaY;
+	deltaX = dataset_max.x - dataset_min.x;
+	deltaY = dataset_max.y - dataset_min.y;
+	std::cout << "DiffX: " << deltaX << " DiffY: " << deltaY << std::endl;
+
+	/*Keep the first point of the cloud to place the camera*/
+	reader.ReadNextPoint();
+	double first_x = reader.GetPoint().GetX(), first_y = reader.GetPoint().GetY();
+
+	/*Calculate area per point to set cell dimension, the tiles of a dataset are assumed to share the density of the largest one*/
+	float value = cell_size_override > 0 ? cell_size_override : estimateCellSize(reader, header);
+	std::cout << "Cell size: " << value << std::endl;
+	cell_size = glm::vec3(value, value, value);
+	boundaries = glm::vec2(deltaX / cell_size.x, deltaY / cell_size.y);
+
+	/*Place the camera on the first point of the cloud*/
+	camera_position = glm::vec3((first_x - dataset_min.x) / cell_size.x, (dataset_max.z - dataset_min.z)/cell_size.z, (first_y - dataset_min.y) / cell_size.x);
+
+	/*Set max height for visualization*/
+	max_height = static_cast<float>(dataset_max.z - dataset_min.z)/cell_size.z;
+
+	/*Close the file stream*/
+	ifs.close();
+}
+
+/*
+ * Height of a cell in percentile mode from its highest tracked heights (sorted in descending order)
+ * The estimate skips the ceil((1 - height_percentile) * count) highest points, so a cell of two or more points always rejects its highest one
+ * It is exact while that rank stays inside the tracked values, beyond percentile_max_cell_points points the rank stays at the last tracked value
+ */
+float percentileHeight(unsigned short *top_values, unsigned short count, float height_range)
+{
+	int rank = static_cast<int>(glm::ceil((1.f - height_percentile) * count - 1e-3f));
+	rank = glm::min(rank, glm::min(static_cast<int>(count), percentile_tracked_values) - 1);
+	return top_values[rank] / static_cast<float>(USHRT_MAX) * height_range;
+}
+
+/*
+ * Add a point's height to the streaming accumulators of a finest cell and store the new cell value in the finest level
+ * Returns the new cell value
+ */
+float accumulateHeight(float *finest_level, int cell, float height, unsigned short *cell_count, unsigned short *cell_top_values, float height_range)
+{
+	unsigned short count = cell_count[cell];
+	float &value = finest_level[cell];
+
+	if (count < USHRT_MAX)
+		cell_count[cell] = ++count;
+
+	switch (height_aggregation)
+	{
+	case HeightAggregation::Min:
+		value = count == 1 ? height : glm::min(value, height);
+		break;
+	case HeightAggregation::Mean:
+		value += (height - value) / count;
+		break;
+	case HeightAggregation::Percentile:
+	{
+		/*Insert the quantized height into the sorted list of highest values*/
+		unsigned short *top_values = cell_top_values + cell * percentile_tracked_values;
+		unsigned short quantized = static_cast<unsigned short>(glm::clamp(height / height_range, 0.f, 1.f) * USHRT_MAX);
+		int k = glm::min(count - 1, percentile_tracked_values - 1);
+		if (count <= percentile_tracked_values || quantized > top_values[k])
+		{
+			while (k > 0 && top_values[k - 1] < quantized)
+			{
+				top_values[k] = top_values[k - 1];
+				k--;
+			}
+			top_values[k] = quantized;
+		}
+		value = percentileHeight(top_values, count, height_range);
+		break;
+	}
+	default:
+		value = glm::max(value, height);
+	}
+
+	return value;
+}
+
+/*
+ * Exact color sums of a cell that took more points than its packed accumulator can count
+ */
+struct ColorSums
+{
+	unsigned int r = 0, g = 0, b = 0, count = 0;
+};
+
+/*
+ * Streaming accumulators of a section while it is being loaded
+ */
+struct SectionAccumulators
+{
+	unsigned short *cell_count = nullptr, *cell_top_values = nullptr;
+	unsigned long long *color_accumulators = nullptr;
+	std::unordered_map<int, ColorSums> color_overflow; // Average cells past color_count_limit points, only touched by the loader thread
+	float height_range = 0;
+	SectionStatistics statistics;
+};
+
+/*
+ * Merge a point's color into the 64 bit accumulator of a finest cell, the channels keep their 8 bits
+ * Average: 18 bit sums per channel and a 10 bit point count, a cell reaching color_count_limit points moves to exact sums in color_overflow
+ * HighestPoint: an occupied bit above the height quantized to 16 bits of the height range above the color, so the highest point wins and ties are broken by color
+ * Both merges are exact and commutative, the result does not depend on the order in which the points arrive
+ */
+void accumulateColor(SectionAccumulators& accumulators, int cell, float height, CudaSpace::Color const& color)
+{
+	unsigned long long &accumulator = accumulators.color_accumulators[cell];
+	unsigned long long r = color.r, g = color.g, b = color.b;
+	if (color_aggregation == ColorAggregation::HighestPoint)
+	{
+		unsigned long long quantized = static_cast<unsigned long long>(glm::clamp(height / accumulators.height_range, 0.f, 1.f) * USHRT_MAX);
+		accumulator = glm::max(accumulator, 1ull << 40 | quantized << 24 | r << 16 | g << 8 | b);
+		return;
+	}
+
+	unsigned long long count = accumulator >> 54;
+	if (count + 1 < color_count_limit)
+	{
+		accumulator += 1ull << 54 | r << 36 | g << 18 | b;
+		return;
+	}
+
+	/*The packed count stays at the limit to mark the cell as overflowed*/
+	ColorSums &sums = accumulators.color_overflow[cell];
+	if (count + 1 == color_count_limit)
+	{
+		sums.r = static_cast<unsigned int>(accumulator >> 36 & 0x3FFFF);
+		sums.g = static_cast<unsigned int>(accumulator >> 18 & 0x3FFFF);
+		sums.b = static_cast<unsigned int>(accumulator & 0x3FFFF);
+		sums.count = static_cast<unsigned int>(count);
+		accumulator = static_cast<unsigned long long>(color_count_limit) << 54;
+	}
+	sums.r += color.r;
+	sums.g += color.g;
+	sums.b += color.b;
+	sums.count++;
+}
+
+/*
+ * Collapse the accumulator of a finest cell into its final color, an empty cell gives black
+ */
+CudaSpace::Color collapseColor(SectionAccumulators const& accumulators, int cell)
+{
+	unsigned long long accumulator = accumulators.color_accumulators[cell];
+	if (color_aggregation == ColorAggregation::HighestPoint)
+		return CudaSpace::Color(static_cast<unsigned char>(accumulator >> 16 & 0xFF), static_cast<unsigned char>(accumulator >> 8 & 0xFF), static_cast<unsigned char>(accumulator & 0xFF));
+
+	unsigned long long r, g, b, count = accumulator >> 54;
+	if (count == color_count_limit)
+	{
+		ColorSums const& sums = accumulators.color_overflow.at(cell);
+		r = sums.r;
+		g = sums.g;
+		b = sums.b;
+		count = sums.count;
+	}
+	else
+	{
+		if (count == 0)
+			return CudaSpace::Color();
+		r = accumulator >> 36 & 0x3FFFF;
+		g = accumulator >> 18 & 0x3FFFF;
+		b = accumulator & 0x3FFFF;
+	}
+
+	return CudaSpace::Color(
+		static_cast<unsigned char>((r + count / 2) / count),
+		static_cast<unsigned char>((g + count / 2) / count),
+		static_cast<unsigned char>((b + count / 2) / count));
+}
+
+/*
+ * Rebuild the coarser levels of a section's quad-tree from its finest level
+ * Every cell holds the highest value of its four children
+ * The layout defaults to the one of the point sections
+ */
+void buildMaxPyramid(float *point_section, int levels, const int *indexes, const int *resolutions)
+{
+	for (int i = 1; i < levels; i++)
+	{
+		float *parent = point_section + indexes[i];
+		float *child = point_section + indexes[i - 1];
+		for (int y = 0; y < resolutions[i]; y++)
+			for (int x = 0; x < resolutions[i]; x++)
+			{
+				int child_index = 2 * x + 2 * y * resolutions[i - 1];
+				parent[x + y * resolutions[i]] = glm::max(
+					glm::max(child[child_index], child[child_index + 1]),
+					glm::max(child[child_index + resolutions[i - 1]], child[child_index + resolutions[i - 1] + 1]));
+			}
+	}
+}
+
+/*
+ * Build the coarser levels of a section's color pyramid from its finest colors
+ * HighestPoint takes the color of the highest child to match the max height pyramid, Average averages the non-empty children
+ * The layout defaults to the one of the point sections
+ */
+void buildColorPyramid(float *point_section, CudaSpace::PackedColor *color_section, int levels, const int *indexes, const int *resolutions)
+{
+	for (int i = 1; i < levels; i++)
+	{
+		CudaSpace::PackedColor *parent = color_section + indexes[i];
+		CudaSpace::PackedColor *child = color_section + indexes[i - 1];
+		float *child_height = point_section + indexes[i - 1];
+		for (int y = 0; y < resolutions[i]; y++)
+			for (int x = 0; x < resolutions[i]; x++)
+			{
+				int children[4];
+				children[0] = 2 * x + 2 * y * resolutions[i - 1];
+				children[1] = children[0] + 1;
+				children[2] = children[0] + resolutions[i - 1];
+				children[3] = children[2] + 1;
+
+				if (color_aggregation == ColorAggregation::HighestPoint)
+				{
+					int highest = children[0];
+					for (int k = 1; k < 4; k++)
+						if (child_height[children[k]] > child_height[highest])
+							highest = children[k];
+					parent[x + y * resolutions[i]] = child[highest];
+				}
+				else
+				{
+					unsigned int r = 0, g = 0, b = 0, count = 0;
+					for (int k = 0; k < 4; k++)
+					{
+						if (child[children[k]] == 0)
+							continue;
+						CudaSpace::Color c = CudaSpace::unpackColor(child[children[k]]);
+						r += c.r;
+						g += c.g;
+						b += c.b;
+						count++;
+					}
+					if (count > 0)
+						parent[x + y * resolutions[i]] = CudaSpace::packColor(CudaSpace::Color(
+							static_cast<unsigned char>((r + count / 2) / count),
+							static_cast<unsigned char>((g + count / 2) / count),
+							static_cast<unsigned char>((b + count / 2) / count)));
+				}
+			}
+	}
+}
+
+/*
+ * Point fields used by the sections, decoded from a liblas point
+ */
+struct DecodedPoint
+{
+	double x, y, z;
+	CudaSpace::Color color;
+	unsigned char classification;
+};
+
+/*
+ * Point range of a block, or of a whole file without block, decoded by a worker
+ */
+struct DecodeRange
+{
+	std::size_t begin, end; // Ids of a whole file range, every point not sampled by the coarse pass is read
+	std::vector<std::size_t> ids; // Ids of chipper block points left to read within one LASzip chunk in file order, replaces begin and end when not empty
+};
+
+/*
+ * Batches of decoded points passed from the decoding workers to their loader
+ */
+struct DecodeQueue
+{
+	std::mutex mutex;
+	std::condition_variable ready, space;
+	std::deque<std::vector<DecodedPoint>> batches;
+	int active_workers = 0;
+	SectionStatistics statistics; // Added by every worker once it is done
+};
+
+DecodedPoint decodePoint(liblas::Point const& p)
+{
+	liblas::Color const& c = p.GetColor();
+	DecodedPoint point;
+	point.x = p.GetX();
+	point.y = p.GetY();
+	point.z = p.GetZ();
+	point.color = CudaSpace::Color(c.GetRed(), c.GetGreen(), c.GetBlue());
+	point.classification = static_cast<unsigned char>(p.GetClassification().GetClass());
+	return point;
+}
+
+/*
+ * Returns true if the point falls in the section, the same test as in ingestPoint
+ */
+bool insideSection(DecodedPoint const& p, glm::vec2 origin, float scale)
+{
+	int x = static_cast<int>(glm::floor(static_cast<float>(p.x - dataset_min.x) / cell_size.x / scale - origin.x));
+	int y = static_cast<int>(glm::floor(static_cast<float>(p.y - dataset_min.y) / cell_size.y / scale - origin.y));
+	return x >= 0 && x < LOD_resolutions[0] && y >= 0 && y < LOD_resolutions[0];
+}
+
+/*
+* Calculate the height and color contribution of a point to its section
+* Positions and heights are divided by the scale of the section's ring
+* Returns false if the point is outside of the section or filtered out
+*/
+bool ingestPoint(DecodedPoint const& p, glm::vec2 origin, float scale, SectionAccumulators& accumulators, float *point_section, CudaSpace::PackedColor *color_section)
+{
+	int x, y; // X and Y coordinates in the finest LOD
+	unsigned int index[LOD_levels];
+	float fX, fY, fZ;
+
+	fX = static_cast<float>(p.x - dataset_min.x) / cell_size.x / scale;
+	fY = static_cast<float>(p.y - dataset_min.y) / cell_size.y / scale;
+	fZ = static_cast<float>(p.z - dataset_min.z) / cell_size.z / scale;
+
+	/* Calculate point position for the finest LOD in this section */
+	x = static_cast<int>(glm::floor(fX - origin.x));
+	y = static_cast<int>(glm::floor(fY - origin.y));
+
+	/* Skip noise and points outside of the section */
+	if (p.classification == 7)
+	{
+		accumulators.statistics.rejected_class++;
+		return false;
+	}
+	if (x < 0 || x >= LOD_resolutions[0] || y < 0 || y >= LOD_resolutions[0])
+	{
+		accumulators.statistics.rejected_bounds++;
+		return false;
+	}
+
+	/* Calculate LOD offsets in section from the coarsest to the finest */
+	for (int i = LOD_levels - 1; i >= 0; i--)
+	{
+		index[i] = LOD_indexes[i] + x / static_cast<int>(glm::pow(2.f, i)) + y / static_cast<int>(glm::pow(2.f, i)) * LOD_resolutions[i];
+	}
+
+	/*Accumulate the color and publish the collapsed value so partially loaded sections are already colored*/
+	accumulateColor(accumulators, x + y * LOD_resolutions[0], fZ, p.color);
+	color_section[index[0]] = CudaSpace::packColor(collapseColor(accumulators, x + y * LOD_resolutions[0]));
+
+	/*Fill the still empty coarser colors until the pyramid is averaged at the end*/
+	for (int i = 1; i < LOD_levels; i++)
+	{
+		if (color_section[index[i]] != 0)
+			break;
+		color_section[index[i]] = color_section[index[0]];
+	}
+
+	/*Aggregate the height in the finest cell, the coarser levels keep an upper bound until the section is finished*/
+	int first_level = 0;
+	if (height_aggregation != HeightAggregation::Max)
+	{
+		fZ = accumulateHeight(point_section + LOD_indexes[0], x + y * LOD_resolutions[0], fZ, accumulators.cell_count, accumulators.cell_top_values, accumulators.height_range);
+		first_level = 1;
+	}
+
+	/*Insert the highest values from finest to coarsest level of the Quad-tree*/
+	for (int i = first_level; i < LOD_levels; i++)
+	{
+		if (*(point_section + index[i]) <= fZ)
+			*(point_section + index[i]) = fZ;
+		else
+			break;
+	}
+
+	accumulators.statistics.points_accepted++;
+	return true;
+}
+
+/*
+ * CPU time spent by the calling thread in seconds
+ * Source: https://msdn.microsoft.com/en-us/library/windows/desktop/ms683237(v=vs.85).aspx
+ */
+double threadCPUTime()
+{
+	FILETIME creation, exit, kernel, user;
+	if (!GetThreadTimes(GetCurrentThread(), &creation, &exit, &kernel, &user))
+		return 0;
+	unsigned long long ticks = (static_cast<unsigned long long>(kernel.dwHighDateTime) << 32 | kernel.dwLowDateTime)
+		+ (static_cast<unsigned long long>(user.dwHighDateTime) << 32 | user.dwLowDateTime);
+	return ticks * 1e-7;
+}
+
+/*
+ * Add the counts and costs of a part of a load to its total
+ */
+void accumulateStatistics(SectionStatistics& total, SectionStatistics const& part)
+{
+	total.points_read += part.points_read;
+	total.points_accepted += part.points_accepted;
+	total.rejected_bounds += part.rejected_bounds;
+	total.rejected_class += part.rejected_class;
+	total.bytes_read += part.bytes_read;
+	total.wall_seconds += part.wall_seconds;
+	total.cpu_seconds += part.cpu_seconds;
+}
+
+/*
+ * Returns true if the point i of a block is one of the sampled points of the coarse pass
+ * hits_before is the number of stride hits of the file's earlier blocks
+ */
+bool isSampledPoint(std::size_t i, std::size_t hits_before, std::size_t sampled_points)
+{
+	return i % progressive_stride == 0 && hits_before + i / progressive_stride < sampled_points;
+}
+
+/*
+ * Decode the ranges of a compressed file on a worker thread with its own reader
+ * Filtered points are handed over in batches to the loader thread, which alone bins them into the section
+ */
+void decodeLASRanges(std::string filename, std::vector<DecodeRange> const *ranges, std::atomic<std::size_t> *next_range, std::size_t sampled_points,
+	glm::vec2 origin, float scale, std::atomic<SectionState> *state, DecodeQueue *queue)
+{
+	traceThreadName("decoder");
+	ScopedTrace trace("decode ranges");
+	std::ifstream ifs;
+	openLASStream(filename, ifs);
+	liblas::ReaderFactory f;
+	liblas::Reader reader = f.CreateWithStream(ifs);
+	std::size_t position = 0;
+	SectionStatistics statistics;
+	double cpu_start = threadCPUTime();
+	std::vector<DecodedPoint> batch;
+	for (std::size_t r = (*next_range)++; r < ranges->size() && *state != SectionState::Cancelled; r = (*next_range)++)
+	{
+		DecodeRange const& range = (*ranges)[r];
+		std::size_t count = range.ids.empty() ? range.end - range.begin : range.ids.size();
+		for (std::size_t k = 0; k < count && *state != SectionState::Cancelled; k++)
+		{
+			std::size_t id = range.ids.empty() ? range.begin + k : range.ids[k];
+			if (range.ids.empty() && isSampledPoint(id, 0, sampled_points))
+				continue;
+			if (!readPointId(reader, id, position))
+				break;
+			statistics.points_read++;
+			DecodedPoint p = decodePoint(reader.GetPoint());
+			if (p.classification == 7)
+				statistics.rejected_class++;
+			else if (!insideSection(p, origin, scale))
+				statistics.rejected_bounds++;
+			else
+				batch.push_back(p);
+			if (batch.size() < decode_batch_points)
+				continue;
+
+			/*Wait for the loader thread when it falls behind so that the queue stays bounded*/
+			std::unique_lock<std::mutex> lock(queue->mutex);
+			queue->space.wait(lock, [queue, state] { return queue->batches.size() < max_decode_batches || *state == SectionState::Cancelled; });
+			queue->batches.push_back(std::move(batch));
+			queue->ready.notify_one();
+			batch.clear();
+		}
+	}
+	ifs.close();
+
+	std::lock_guard<std::mutex> lock(queue->mutex);
+	if (!batch.empty())
+		queue->batches.push_back(std::move(batch));
+	statistics.cpu_seconds = threadCPUTime() - cpu_start;
+	accumulateStatistics(queue->statistics, statistics);
+	queue->active_workers--;
+	queue->ready.notify_one();
+}
+
+/*
+ * Full pass over a compressed file with laz_decode_workers decoding chunk aligned ranges in parallel
+ * The calling loader thread bins the decoded points as they arrive
+ */
+void ingestLASFileParallel(int file, std::vector<ChipBlock const*> const& blocks, std::size_t sampled_points,
+	glm::vec2 origin, float scale, std::atomic<SectionState> *state, SectionAccumulators& accumulators, float *point_section, CudaSpace::PackedColor *color_section)
+{
+	/*Whole files split on chunk borders, the block points left after the coarse pass are sorted by id and grouped per chunk*/
+	std::vector<DecodeRange> ranges;
+	if (blocks.size() == 1 && blocks[0] == nullptr)
+	{
+		std::size_t count = catalog[file].point_count;
+		for (std::size_t begin = 0; begin < count; begin += laz_chunk_points)
+			ranges.push_back({ begin, glm::min(begin + laz_chunk_points, count), {} });
+	}
+	else
+	{
+		std::vector<std::size_t> ids;
+		std::size_t hits_before = 0;
+		for (ChipBlock const* block : blocks)
+		{
+			for (std::size_t i = 0; i < block->ids.size(); i++)
+				if (!isSampledPoint(i, hits_before, sampled_points))
+					ids.push_back(block->ids[i]);
+			hits_before += (block->ids.size() + progressive_stride - 1) / progressive_stride;
+		}
+		std::sort(ids.begin(), ids.end());
+		for (std::size_t id : ids)
+		{
+			if (ranges.empty() || ranges.back().ids.back() / laz_chunk_points != id / laz_chunk_points)
+				ranges.push_back({ 0, 0, {} });
+			ranges.back().ids.push_back(id);
+		}
+	}
+
+	DecodeQueue queue;
+	std::atomic<std::size_t> next_range(0);
+	int workers = static_cast<int>(glm::min(static_cast<std::size_t>(laz_decode_workers), ranges.size()));
+	queue.active_workers = workers;
+	std::vector<std::thread> threads;
+	for (int i = 0; i < workers; i++)
+		threads.emplace_back(decodeLASRanges, catalog[file].filename, &ranges, &next_range, sampled_points, origin, scale, state, &queue);
+
+	while (true)
+	{
+		std::vector<DecodedPoint> batch;
+		{
+			std::unique_lock<std::mutex> lock(queue.mutex);
+			queue.ready.wait(lock, [&queue, state] { return !queue.batches.empty() || queue.active_workers == 0 || *state == SectionState::Cancelled; });
+			if (queue.batches.empty() || *state == SectionState::Cancelled)
+				break;
+			batch = std::move(queue.batches.front());
+			queue.batches.pop_front();
+			queue.space.notify_all();
+		}
+		for (DecodedPoint const& p : batch)
+			ingestPoint(p, origin, scale, accumulators, point_section, color_section);
+	}
+
+	/*Release the workers waiting for space if the section was cancelled meanwhile, their queued batches are dropped*/
+	queue.space.notify_all();
+	for (std::thread& thread : threads)
+		thread.join();
+	accumulateStatistics(accumulators.statistics, queue.statistics);
+}
+
+/*
+* Load points using libLas Library in LAS format from the catalog files overlapping the section
+* With the chipper only the blocks overlapping the section are read, otherwise every point of the files
+* A strided subsample is loaded first and published as valid down to a coarse LOD, the remaining points then refine the section to LOD 0
+* A completed section is handed over to its ring, a cancelled one is freed by the loader
+* Source: http://www.liblas.org/tutorial/cpp.html
+*/
+void loadLASToSection(glm::vec2 origin, float scale, std::atomic<SectionState> *state, std::atomic<int> *valid_LOD, float *point_section, CudaSpace::PackedColor * color_section)
+{
+	traceThreadName("loader");
+	long long trace_start = tracing_enabled ? traceTimestamp() : -1; // Loads started before tracing was enabled are not recorded
+	std::chrono::steady_clock::time_point wall_start = std::chrono::steady_clock::now();
+	double cpu_start = threadCPUTime();
+	glm::vec2 section_min = origin * scale, section_max = (origin + glm::vec2(static_cast<float>(LOD_resolutions[0]))) * scale;
+	std::vector<int> files = catalogFilesOverlapping(section_min, section_max);
+
+	/*Blocks of point ids to read in every file, a null block stands for the whole file*/
+	std::vector<std::vector<ChipBlock const*>> file_blocks(files.size());
+	for (std::size_t file = 0; file < files.size(); file++)
+	{
+		if (use_chipper)
+			file_blocks[file] = catalogBlocksOverlapping(files[file], section_min, section_max);
+		else
+			file_blocks[file].push_back(nullptr);
+	}
+
+	/*Allocate the streaming accumulators of the selected height aggregation, the max aggregation needs none*/
+	SectionAccumulators accumulators;
+	accumulators.height_range = static_cast<float>(dataset_max.z - dataset_min.z) / cell_size.z / scale;
+	if (height_aggregation != HeightAggregation::Max)
+		accumulators.cell_count = new unsigned short[LOD_resolutions[0] * LOD_resolutions[0]]();
+	if (height_aggregation == HeightAggregation::Percentile)
+		accumulators.cell_top_values = new unsigned short[LOD_resolutions[0] * LOD_resolutions[0] * percentile_tracked_values]();
+	accumulators.color_accumulators = new unsigned long long[LOD_resolutions[0] * LOD_resolutions[0]]();
+	long long accumulator_bytes = sizeof(unsigned long long) * LOD_resolutions[0] * LOD_resolutions[0];
+	if (accumulators.cell_count != nullptr)
+		accumulator_bytes += sizeof(unsigned short) * LOD_resolutions[0] * LOD_resolutions[0];
+	if (accumulators.cell_top_values != nullptr)
+		accumulator_bytes += sizeof(unsigned short) * LOD_resolutions[0] * LOD_resolutions[0] * percentile_tracked_values;
+	trackMemory(MemoryClass::Loaders, accumulator_bytes);
+
+	/*Coarse pass: load every progressive_stride-th point of every file and publish the LOD that holds enough of them per cell*/
+	std::vector<std::size_t> sampled_points(files.size(), 0);
+	if (progressive_loading)
+	{
+		for (std::size_t file = 0; file < files.size() && *state != SectionState::Cancelled; file++)
+		{
+			/*Create input stream and associate it with .las file opened to read in binary mode*/
+			std::ifstream ifs;
+			openLASStream(catalog[files[file]].filename, ifs);
+			traceInstant("open file", "file", files[file], "pass", 0);
+			liblas::ReaderFactory f;
+			liblas::Reader reader = f.CreateWithStream(ifs);
+			std::size_t position = 0;
+			for (ChipBlock const* block : file_blocks[file])
+			{
+				std::size_t count = block != nullptr ? block->ids.size() : catalog[files[file]].point_count;
+				for (std::size_t i = 0; i < count && *state != SectionState::Cancelled; i += progressive_stride, sampled_points[file]++)
+				{
+					if (!readPointId(reader, block != nullptr ? block->ids[i] : i, position))
+						break;
+					accumulators.statistics.points_read++;
+					ingestPoint(decodePoint(reader.GetPoint()), origin, scale, accumulators, point_section, color_section);
+				}
+			}
+			ifs.close();
+			accumulators.statistics.bytes_read += sampled_points[file] * catalog[files[file]].point_bytes;
+		}
+		valid_LOD->store(glm::min(valid_LOD->load(std::memory_order_relaxed), glm::clamp(static_cast<int>(glm::ceil(glm::log(progressive_stride / points_per_cell) / glm::log(4.f))), 0, LOD_levels - 1)), std::memory_order_release);
+	}
+
+	/*Iterate through point records and calculate the height contribution to each neighboring grid cell, skipping the sampled points*/
+	for (std::size_t file = 0; file < files.size() && *state != SectionState::Cancelled; file++)
+	{
+		traceInstant("open file", "file", files[file], "pass", 1);
+		std::size_t read_before = accumulators.statistics.points_read;
+		if (catalog[files[file]].compressed && laz_decode_workers > 1)
+		{
+			ingestLASFileParallel(files[file], file_blocks[file], sampled_points[file], origin, scale, state, accumulators, point_section, color_section);
+			accumulators.statistics.bytes_read += (accumulators.statistics.points_read - read_before) * catalog[files[file]].point_bytes;
+			continue;
+		}
+
+		std::ifstream ifs;
+		openLASStream(catalog[files[file]].filename, ifs);
+		liblas::ReaderFactory f;
+		liblas::Reader reader = f.CreateWithStream(ifs);
+		std::size_t position = 0, hits_before = 0;
+		for (ChipBlock const* block : file_blocks[file])
+		{
+			std::size_t count = block != nullptr ? block->ids.size() : catalog[files[file]].point_count;
+			for (std::size_t i = 0; i < count && *state != SectionState::Cancelled; i++)
+			{
+				/*The sampled points are the stride hits in the same order as the coarse pass*/
+				if (isSampledPoint(i, hits_before, sampled_points[file]))
+					continue;
+				if (!readPointId(reader, block != nullptr ? block->ids[i] : i, position))
+					break;
+				accumulators.statistics.points_read++;
+				ingestPoint(decodePoint(reader.GetPoint()), origin, scale, accumulators, point_section, color_section);
+			}
+			hits_before += (count + progressive_stride - 1) / progressive_stride;
+		}
+
+		/*Close the file stream*/
+		ifs.close();
+		accumulators.statistics.bytes_read += (accumulators.statistics.points_read - read_before) * catalog[files[file]].point_bytes;
+	}
+
+	/*Tighten the coarser levels to the final aggregated heights and build the coarser colors*/
+	if (height_aggregation != HeightAggregation::Max && *state != SectionState::Cancelled)
+		buildMaxPyramid(point_section);
+	if (*state != SectionState::Cancelled)
+	{
+		buildColorPyramid(point_section, color_section);
+		valid_LOD->store(0, std::memory_order_release);
+	}
+	delete[]accumulators.cell_count;
+	delete[]accumulators.cell_top_values;
+	delete[]accumulators.color_accumulators;
+	trackMemory(MemoryClass::Loaders, -accumulator_bytes);
+	if (trace_start >= 0 && tracing_enabled)
+		traceComplete("load section", trace_start, traceTimestamp() - trace_start, "scanned", accumulators.statistics.points_read, "accepted", accumulators.statistics.points_accepted);
+
+	/*Record the telemetry of the load, the workers' CPU time is already in the statistics*/
+	SectionStatistics& statistics = accumulators.statistics;
+	statistics.origin = origin;
+	statistics.scale = scale;
+	statistics.wall_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - wall_start).count();
+	statistics.cpu_seconds += threadCPUTime() - cpu_start;
+	statistics.cancelled = *state == SectionState::Cancelled;
+	{
+		std::lock_guard<std::mutex> lock(section_statistics_mutex);
+		section_statistics.push_back(statistics);
+	}
+
+	/*Hand the section over to the ring unless it was unloaded meanwhile*/
+	SectionState loading = SectionState::Loading;
+	if (state->compare_exchange_strong(loading, SectionState::Complete))
+	{
+		traceInstant("section finished", "x", static_cast<long long>(origin.x), "y", static_cast<long long>(origin.y));
+		return;
+	}
+	traceInstant("section cancelled", "x", static_cast<long long>(origin.x), "y", static_cast<long long>(origin.y));
+	delete[]point_section;	
+	delete[]color_section;
+	trackMemory(MemoryClass::Cancelled, -static_cast<long long>(sectionBytes()));
+	delete state;
+	delete valid_LOD;
+}
+
+
+/*
+ * Highest point of every cell of a square grid over the bounds of a catalog file, heights are above the file minimum and empty cells have no color
+ */
+struct FileSummary
+{
+	int resolution = 0;
+	std::vector<float> heights;
+	std::vector<CudaSpace::PackedColor> colors;
+};
+
+/*
+ * Summary cells about as large as the overview cells, a power of two so that small changes of the dataset keep the cached summaries
+ */
+int summaryResolution(CatalogFile const& file)
+{
+	double extent = glm::max(file.max.x - file.min.x, file.max.y - file.min.y);
+	double dataset_extent = glm::max(dataset_max.x - dataset_min.x, dataset_max.y - dataset_min.y);
+	int resolution = 16;
+	while (resolution < overview_max_resolution && resolution < overview_max_resolution * extent / dataset_extent)
+		resolution *= 2;
+	return resolution;
+}
+
+/*
+ * Read the summary cached next to a file, returns false if it is missing, outdated, of another resolution or of another packed color layout
+ */
+bool loadFileSummary(CatalogFile const& file, int resolution, FileSummary& summary)
+{
+	std::ifstream ifs("../Data/" + file.filename + summary_file_extension, std::ios::in | std::ios::binary);
+	unsigned long long size = 0, modified = 0;
+	int stored = 0, color_format = 0;
+	ifs.read(reinterpret_cast<char*>(&size), sizeof(size));
+	ifs.read(reinterpret_cast<char*>(&modified), sizeof(modified));
+	ifs.read(reinterpret_cast<char*>(&stored), sizeof(stored));
+	ifs.read(reinterpret_cast<char*>(&color_format), sizeof(color_format));
+	if (!ifs || size != file.file_size || modified != file.modified || stored != resolution || color_format != CudaSpace::packed_color_format)
+		return false;
+	summary.resolution = resolution;
+	summary.heights.resize(resolution * resolution);
+	summary.colors.resize(resolution * resolution);
+	ifs.read(reinterpret_cast<char*>(summary.heights.data()), sizeof(float) * summary.heights.size());
+	ifs.read(reinterpret_cast<char*>(summary.colors.data()), sizeof(CudaSpace::PackedColor) * summary.colors.size());
+	return static_cast<bool>(ifs);
+}
+
+void saveFileSummary(CatalogFile const& file, FileSummary const& summary)
+{
+	std::ofstream ofs("../Data/" + file.filename + summary_file_extension, std::ios::out | std::ios::binary);
+	if (!ofs.is_open())
+		return;
+	ofs.write(reinterpret_cast<const char*>(&file.file_size), sizeof(file.file_size));
+	ofs.write(reinterpret_cast<const char*>(&file.modified), sizeof(file.modified));
+	ofs.write(reinterpret_cast<const char*>(&summary.resolution), sizeof(summary.resolution));
+	ofs.write(reinterpret_cast<const char*>(&CudaSpace::packed_color_format), sizeof(CudaSpace::packed_color_format));
+	ofs.write(reinterpret_cast<const char*>(summary.heights.data()), sizeof(float) * summary.heights.size());
+	ofs.write(reinterpret_cast<const char*>(summary.colors.data()), sizeof(CudaSpace::PackedColor) * summary.colors.size());
+}
+
+/*
+ * Read every point of a file into its summary, returns false if the overview was stopped meanwhile
+ */
+bool buildFileSummary(CatalogFile const& file, int resolution, FileSummary& summary)
+{
+	summary.resolution = resolution;
+	summary.heights.assign(resolution * resolution, 0.f);
+	summary.colors.assign(resolution * resolution, 0);
+	glm::dvec2 cell = glm::max(glm::dvec2(file.max.x - file.min.x, file.max.y - file.min.y) / static_cast<double>(resolution), glm::dvec2(1e-9));
+
+	std::ifstream ifs;
+	openLASStream(file.filename, ifs);
+	liblas::ReaderFactory f;
+	liblas::Reader reader = f.CreateWithStream(ifs);
+	while (!overview_exit && reader.ReadNextPoint())
+	{
+		liblas::Point const& p = reader.GetPoint();
+		if (p.GetClassification().GetClass() == 7)
+			continue;
+		int x = glm::clamp(static_cast<int>((p.GetX() - file.min.x) / cell.x), 0, resolution - 1);
+		int y = glm::clamp(static_cast<int>((p.GetY() - file.min.y) / cell.y), 0, resolution - 1);
+		float height = static_cast<float>(p.GetZ() - file.min.z);
+		int index = x + y * resolution;
+		if (summary.colors[index] != 0 && summary.heights[index] >= height)
+			continue;
+		liblas::Color const& c = p.GetColor();
+		summary.heights[index] = height;
+		summary.colors[index] = CudaSpace::packColor(CudaSpace::Color(c.GetRed(), c.GetGreen(), c.GetBlue()));
+	}
+	return !overview_exit;
+}
+
+/*
+ * Insert a height into a finest overview cell, from finest to coarsest level, and fill the still empty coarser colors
+ */
+void insertOverviewPoint(int x, int y, float fZ, CudaSpace::PackedColor color)
+{
+	int resolution = overview_grid.LOD_resolutions[0];
+	if (x < 0 || x >= resolution || y < 0 || y >= resolution)
+		return;
+	int cell = overview_grid.LOD_indexes[0] + x + y * resolution;
+	if (h_overview_heights[cell] > fZ && h_overview_colors[cell] != 0)
+		return;
+	h_overview_colors[cell] = color;
+	for (int i = 0; i < overview_LOD_levels; i++)
+	{
+		int index = overview_grid.LOD_indexes[i] + (x >> i) + (y >> i) * overview_grid.LOD_resolutions[i];
+		if (h_overview_colors[index] == 0)
+			h_overview_colors[index] = color;
+		if (h_overview_heights[index] <= fZ)
+			h_overview_heights[index] = fZ;
+		else
+			break;
+	}
+}
+
+/*
+ * Fill the whole dataset overview from the summaries of the catalog files, keeping the highest point of each cell
+ * Summaries are cached next to their files, so only the first run, or a changed file, reads the points
+ */
+void loadLASToOverview()
+{
+	traceThreadName("overview");
+	ScopedTrace trace("load overview");
+	for (std::size_t file = 0; file < catalog.size() && !overview_exit; file++)
+	{
+		CatalogFile const& entry = catalog[file];
+		FileSummary summary;
+		int resolution = summaryResolution(entry);
+		if (!loadFileSummary(entry, resolution, summary))
+		{
+			if (!buildFileSummary(entry, resolution, summary))
+				break;
+			saveFileSummary(entry, summary);
+		}
+
+		/*Splat every summary cell over the overview cells it covers, overview cells and heights are scaled so that they stay cubic*/
+		glm::dvec2 cell = glm::max(glm::dvec2(entry.max.x - entry.min.x, entry.max.y - entry.min.y) / static_cast<double>(resolution), glm::dvec2(1e-9));
+		glm::dvec2 overview_cell = glm::dvec2(cell_size.x, cell_size.y) * static_cast<double>(overview_grid.scale);
+		for (int y = 0; y < resolution; y++)
+			for (int x = 0; x < resolution; x++)
+			{
+				int index = x + y * resolution;
+				if (summary.colors[index] == 0)
+					continue;
+				float fZ = static_cast<float>(entry.min.z + summary.heights[index] - dataset_min.z) / cell_size.z / overview_grid.scale;
+				glm::dvec2 start = (glm::dvec2(entry.min.x, entry.min.y) + glm::dvec2(x, y) * cell - glm::dvec2(dataset_min.x, dataset_min.y)) / overview_cell;
+				glm::ivec2 first = glm::ivec2(glm::floor(start));
+				glm::ivec2 last = glm::max(first, glm::ivec2(glm::ceil(start + cell / overview_cell)) - 1);
+				for (int oy = first.y; oy <= last.y; oy++)
+					for (int ox = first.x; ox <= last.x; ox++)
+						insertOverviewPoint(ox, oy, fZ, summary.colors[index]);
+			}
+	}
+
+	if (!overview_exit)
+	{
+		buildColorPyramid(h_overview_heights, h_overview_colors, overview_LOD_levels, overview_grid.LOD_indexes, overview_grid.LOD_resolutions);
+		overview_complete = true;
+	}
+}
+
+
+//============================
+//		SECTION AND GRID
+//          FUNCTIONS
+//============================
+
+/*
+ * Inner threads of the finest ring load with a higher priority than the outer and coarser ones
+ */
+void setSectionPriority(SectionRing& ring, int x, int y)
+{
+	/*Sections restored from the cache have no loader*/
+	if (ring.thread_pool[x][y] == nullptr)
+		return;
+	if (&ring == &section_rings[0] && x >= 1 && x <= 2 && y >= 1 && y <= 2)
+		SetThreadPriority(ring.thread_pool[x][y]->native_handle(), 0);
+	else
+		SetThreadPriority(ring.thread_pool[x][y]->native_handle(), -2);
+}
+
+/*
+ * Integer coordinates of a section, origins are aligned to whole section extents of the ring
+ */
+glm::ivec2 sectionTile(glm::vec2 origin)
+{
+	return glm::ivec2(glm::round(origin / (static_cast<float>(glm::pow(2.0f, LOD_levels - 1)) * glm::vec2(point_buffer_resolution))));
+}
+
+/*
+ * Slot of the section of a ring with the given tile, returns false if the ring does not hold it
+ */
+bool findSection(SectionRing const& ring, glm::ivec2 tile, glm::ivec2& slot)
+{
+	for (slot.x = 0; slot.x < point_sections_size; slot.x++)
+		for (slot.y = 0; slot.y < point_sections_size; slot.y++)
+			if (sectionTile(ring.point_sections_origins[slot.x][slot.y]) == tile)
+				return true;
+	return false;
+}
+
+/*
+ * A section of an outer ring is covered when the inner ring holds the four sections it spans
+ */
+bool sectionCovered(int ring, glm::ivec2 tile)
+{
+	if (ring == 0)
+		return false;
+	glm::ivec2 slot;
+	for (int k = 0; k < 4; k++)
+		if (!findSection(section_rings[ring - 1], tile * 2 + glm::ivec2(k % 2, k / 2), slot))
+			return false;
+	return true;
+}
+
+/*
+ * Finest completely loaded LOD of a section, a covered section is one level coarser than the best of its inner sections
+ */
+int sectionValidLOD(int ring, glm::ivec2 slot)
+{
+	SectionRing const& r = section_rings[ring];
+	if (!r.covered[slot.x][slot.y])
+		return r.section_valid_LOD[slot.x][slot.y]->load(std::memory_order_acquire);
+
+	glm::ivec2 tile = sectionTile(r.point_sections_origins[slot.x][slot.y]), child;
+	int valid = 0;
+	for (int k = 0; k < 4; k++)
+	{
+		findSection(section_rings[ring - 1], tile * 2 + glm::ivec2(k % 2, k / 2), child);
+		valid = glm::max(valid, sectionValidLOD(ring - 1, child) - 1);
+	}
+	return valid;
+}
+
+/*
+ * Copy count cells of a row of a section level to heights and colors, heights are multiplied by factor
+ * A covered section reads level i from level i + 1 of the inner sections, whose heights are in cells half as large
+ * Its coarsest level keeps the highest of each 2x2 block of the inner coarsest levels
+ */
+void copySectionRow(int ring, glm::ivec2 slot, int level, int row, int first, int count, float factor, float *heights, CudaSpace::PackedColor *colors)
+{
+	SectionRing const& r = section_rings[ring];
+	if (!r.covered[slot.x][slot.y])
+	{
+		int offset = LOD_indexes[level] + first + row * LOD_resolutions[level];
+		if (factor == 1)
+			memcpy(heights, r.point_sections[slot.x][slot.y] + offset, sizeof(float) * count);
+		else
+			for (int k = 0; k < count; k++)
+				heights[k] = r.point_sections[slot.x][slot.y][offset + k] * factor;
+		memcpy(colors, r.color_sections[slot.x][slot.y] + offset, sizeof(CudaSpace::PackedColor) * count);
+		return;
+	}
+
+	glm::ivec2 tile = sectionTile(r.point_sections_origins[slot.x][slot.y]), child;
+	int half = LOD_resolutions[level] / 2; // Cells of the level spanned by one inner section
+	if (level < LOD_levels - 1)
+	{
+		for (int x = first; x < first + count;)
+		{
+			int end = glm::min(first + count, (x / half + 1) * half);
+			findSection(section_rings[ring - 1], tile * 2 + glm::ivec2(x / half, row / half), child);
+			copySectionRow(ring - 1, child, level + 1, row % half, x % half, end - x, factor * .5f, heights + x - first, colors + x - first);
+			x = end;
+		}
+		return;
+	}
+
+	int resolution = LOD_resolutions[level];
+	std::vector<float> child_heights(2 * resolution);
+	std::vector<CudaSpace::PackedColor> child_colors(2 * resolution);
+	for (int x = first; x < first + count; x++)
+	{
+		if (x == first || x % half == 0)
+		{
+			findSection(section_rings[ring - 1], tile * 2 + glm::ivec2(x / half, row / half), child);
+			for (int k = 0; k < 2; k++)
+				copySectionRow(ring - 1, child, level, 2 * (row % half) + k, 0, resolution, factor * .5f, &child_heights[k * resolution], &child_colors[k * resolution]);
+		}
+		int highest = 2 * (x % half);
+		for (int k = 1; k < 4; k++)
+		{
+			int cell = 2 * (x % half) + k % 2 + k / 2 * resolution;
+			if (child_heights[cell] > child_heights[highest])
+				highest = cell;
+		}
+		heights[x - first] = child_heights[highest];
+		colors[x - first] = child_colors[highest];
+	}
+}
+
+/*
+ * Append count values as blocks of zigzag encoded deltas, every block stores its bit width followed by the packed deltas
+ */
+template<typename Value>
+void packValues(Value value, int count, std::vector<unsigned int>& packed)
+{
+	unsigned int previous = 0;
+	unsigned int deltas[pack_block_size];
+	for (int start = 0; start < count; start += pack_block_size)
+	{
+		int n = glm::min(pack_block_size, count - start);
+		unsigned int used_bits = 0;
+		for (int i = 0; i < n; i++)
+		{
+			unsigned int current = value(start + i);
+			int delta = static_cast<int>(current - previous);
+			deltas[i] = (static_cast<unsigned int>(delta) << 1) ^ static_cast<unsigned int>(delta >> 31);
+			used_bits |= deltas[i];
+			previous = current;
+		}
+		int bits = 0;
+		while (bits < 32 && (used_bits >> bits) != 0)
+			bits++;
+		packed.push_back(bits);
+
+		unsigned long long buffer = 0;
+		int filled = 0;
+		for (int i = 0; i < n; i++)
+		{
+			buffer |= static_cast<unsigned long long>(deltas[i]) << filled;
+			filled += bits;
+			if (filled >= 32)
+			{
+				packed.push_back(static_cast<unsigned int>(buffer));
+				buffer >>= 32;
+				filled -= 32;
+			}
+		}
+		if (filled > 0)
+			packed.push_back(static_cast<unsigned int>(buffer));
+	}
+}
+
+/*
+ * Read count values packed by packValues starting at position, returns the position after them
+ */
+template<typename Store>
+std::size_t unpackValues(std::vector<unsigned int> const& packed, std::size_t position, int count, Store store)
+{
+	unsigned int previous = 0;
+	for (int start = 0; start < count; start += pack_block_size)
+	{
+		int n = glm::min(pack_block_size, count - start);
+		int bits = packed[position++];
+		unsigned long long mask = (1ull << bits) - 1;
+		unsigned long long buffer = 0;
+		int filled = 0;
+		for (int i = 0; i < n; i++)
+		{
+			if (filled < bits)
+			{
+				buffer |= static_cast<unsigned long long>(packed[position++]) << filled;
+				filled += 32;
+			}
+			unsigned int zigzag = static_cast<unsigned int>(buffer & mask);
+			buffer >>= bits;
+			filled -= bits;
+			previous += (zigzag >> 1) ^ (0u - (zigzag & 1));
+			store(start + i, previous);
+		}
+	}
+	return position;
+}
+
+/*
+ * Pack the raw buffers of a cached section, returns the height of a quantization step
+ * Heights are quantized upwards to a fraction of the section's highest point so that the pyramid stays a max pyramid
+ */
+float compressSection(float const *point_section, CudaSpace::PackedColor const *color_section, std::vector<unsigned int>& packed)
+{
+	int count = stride_x * point_buffer_resolution.x * point_buffer_resolution.y;
+	float highest = 0;
+	for (int i = 0; i < LOD_resolutions[LOD_levels - 1] * LOD_resolutions[LOD_levels - 1]; i++)
+		highest = glm::max(highest, point_section[LOD_indexes[LOD_levels - 1] + i]);
+	float step = highest > 0 ? highest / height_quantization_steps : 1;
+
+	packValues([point_section, step](int i) { return static_cast<unsigned int>(glm::ceil(point_section[i] / step)); }, count, packed);
+	packValues([color_section](int i) { return static_cast<unsigned int>(color_section[i]); }, count, packed);
+	packed.shrink_to_fit();
+	return step;
+}
+
+/*
+ * Compressor thread, packs the queued sections one at a time outside the lock
+ * A packed section replaces its raw buffers unless it was evicted meanwhile, the raw buffers are freed either way
+ */
+void runSectionCompressor()
+{
+	traceThreadName("compressor");
+	std::unique_lock<std::mutex> lock(section_compressor_mutex);
+	while (true)
+	{
+		section_compressor_wake.wait(lock, [] { return section_compressor_exit || !section_compress_queue.empty(); });
+		if (section_compressor_exit)
+			return;
+		CachedSection *section = section_compress_queue.front();
+		section_compress_queue.pop_front();
+		section_compressing = section;
+		float *point_section = section->point_section;
+		CudaSpace::PackedColor *color_section = section->color_section;
+		lock.unlock();
+
+		std::vector<unsigned int> packed;
+		float step;
+		{
+			ScopedTrace trace("compress section");
+			step = compressSection(point_section, color_section, packed);
+		}
+
+		lock.lock();
+		if (section_compressing == section)
+		{
+			section->packed = std::move(packed);
+			section->height_step = step;
+			section->point_section = nullptr;
+			section->color_section = nullptr;
+			long long bytes = sizeof(unsigned int) * section->packed.size();
+			trackMemory(MemoryClass::Cache, bytes - section->bytes);
+			section->bytes = bytes;
+		}
+		delete[] point_section;
+		delete[] color_section;
+		section_compressing = nullptr;
+		section_compressor_idle.notify_all();
+	}
+}
+
+/*
+ * Take a cached section away from the compressor, returns true if the compressor still reads its raw buffers and will free them
+ * With wait the call returns once the compressor is done with the section instead
+ */
+bool withdrawFromCompressor(CachedSection *section, bool wait)
+{
+	std::unique_lock<std::mutex> lock(section_compressor_mutex);
+	auto queued = std::find(section_compress_queue.begin(), section_compress_queue.end(), section);
+	if (queued != section_compress_queue.end())
+		section_compress_queue.erase(queued);
+	if (section_compressing != section)
+		return false;
+	if (!wait)
+	{
+		section_compressing = nullptr;
+		return true;
+	}
+	section_compressor_idle.wait(lock, [section] { return section_compressing != section; });
+	return false;
+}
+
+/*
+ * Stop the compressor thread, the cache must be empty
+ */
+void stopSectionCompressor()
+{
+	if (section_compressor == nullptr)
+		return;
+	{
+		std::lock_guard<std::mutex> lock(section_compressor_mutex);
+		section_compressor_exit = true;
+	}
+	section_compressor_wake.notify_all();
+	section_compressor->join();
+	delete section_compressor;
+	section_compressor = nullptr;
+}
+
+/*
+ * Unpack a compressed section on a worker thread, following the loader handshake so that it is owned and cancelled like a loading section
+ */
+void restoreSection(CachedSection *section, std::atomic<SectionState> *state, std::atomic<int> *valid_LOD, float *point_section, CudaSpace::PackedColor *color_section)
+{
+	int count = stride_x * point_buffer_resolution.x * point_buffer_resolution.y;
+	float step = section->height_step;
+	std::size_t position = unpackValues(section->packed, 0, count, [point_section, step](int i, unsigned int height) { point_section[i] = height * step; });
+	unpackValues(section->packed, position, count, [color_section](int i, unsigned int color) { color_section[i] = static_cast<CudaSpace::PackedColor>(color); });
+	delete section;
+
+	valid_LOD->store(0, std::memory_order_release);
+	SectionState loading = SectionState::Loading;
+	if (state->compare_exchange_strong(loading, SectionState::Complete))
+		return;
+	delete[]point_section;
+	delete[]color_section;
+	trackMemory(MemoryClass::Cancelled, -static_cast<long long>(sectionBytes()));
+	delete state;
+	delete valid_LOD;
+}
+
+/*
+ * Free the least recently evicted section of the cache, a section being packed is left to the compressor to free
+ */
+void evictCachedSection()
+{
+	CachedSection& section = section_cache.back();
+	if (!withdrawFromCompressor(&section, false))
+	{
+		delete[] section.point_section;
+		delete[] section.color_section;
+	}
+	trackMemory(MemoryClass::Cache, -section.bytes);
+	section_cache.pop_back();
+}
+
+/*
+ * Keep an evicted section for a later visit, the least recently evicted sections are freed to stay in the budget
+ * The section's memory must already be accounted to the cache, it is compressed in the background if enabled
+ */
+void cacheSection(int ring, glm::ivec2 tile, float *point_section, CudaSpace::PackedColor *color_section)
+{
+	CachedSection section;
+	section.ring = ring;
+	section.tile = tile;
+	section.point_section = point_section;
+	section.color_section = color_section;
+	section.bytes = sectionBytes();
+	section_cache.push_front(section);
+	while (!section_cache.empty() && static_cast<std::size_t>(memory_usage[static_cast<int>(MemoryClass::Cache)]) > section_cache_budget)
+		evictCachedSection();
+
+	if (compress_cached_sections && !section_cache.empty() && section_cache.front().point_section == point_section)
+	{
+		if (section_compressor == nullptr)
+		{
+			section_compressor = new std::thread(runSectionCompressor);
+			SetThreadPriority(section_compressor->native_handle(), -2);
+		}
+		std::lock_guard<std::mutex> lock(section_compressor_mutex);
+		section_compress_queue.push_back(&section_cache.front());
+		section_compressor_wake.notify_one();
+	}
+}
+
+/*
+ * Remove a section from the cache and hand it to owner, returns false if it is not cached
+ * A compressed section is unpacked by a worker thread returned like a loader, an uncompressed one is complete at once
+ */
+bool restoreCachedSection(MemoryClass owner, int ring, glm::ivec2 tile, std::thread *&thread, std::atomic<SectionState> *&state, std::atomic<int> *&valid_LOD, float *&point_section, CudaSpace::PackedColor *&color_section)
+{
+	for (auto it = section_cache.begin(); it != section_cache.end(); ++it)
+	{
+		if (it->ring != ring || it->tile != tile)
+			continue;
+		/*Only a section the compressor is packing right now is waited for*/
+		withdrawFromCompressor(&*it, true);
+		trackMemory(MemoryClass::Cache, -it->bytes);
+		trackMemory(owner, sectionBytes());
+
+		if (it->point_section != nullptr)
+		{
+			point_section = it->point_section;
+			color_section = it->color_section;
+			state = new std::atomic<SectionState>(SectionState::Complete);
+			valid_LOD = new std::atomic<int>(0);
+			thread = nullptr;
+		}
+		else
+		{
+			point_section = new float[stride_x * point_buffer_resolution.x * point_buffer_resolution.y]();
+			color_section = new CudaSpace::PackedColor[stride_x * point_buffer_resolution.x * point_buffer_resolution.y]();
+			state = new std::atomic<SectionState>(SectionState::Loading);
+			valid_LOD = new std::atomic<int>(LOD_levels - 1);
+			thread = new std::thread(restoreSection, new CachedSection(std::move(*it)), state, valid_LOD, point_section, color_section);
+		}
+		section_cache.erase(it);
+		return true;
+	}
+	return false;
+}
+
+/*
+ * Allocate a grid section for the out-of-core functionality
+ * The quad-tree piramid is allocate contiguously to facilitate the copy of a section
+ * Sections found in the cache are restored without a loader, prefetched sections keep theirs
+ */
+void allocateSection(SectionRing& ring, glm::ivec2 pos, glm::vec2 origin)
+{
+	int ring_index = static_cast<int>(&ring - section_rings);
+	ring.point_sections_origins[pos.x][pos.y] = origin;
+	ring.covered[pos.x][pos.y] = sectionCovered(ring_index, sectionTile(origin));
+	if (ring.covered[pos.x][pos.y])
+	{
+		ring.point_sections[pos.x][pos.y] = nullptr;
+		ring.color_sections[pos.x][pos.y] = nullptr;
+		ring.section_state[pos.x][pos.y] = new std::atomic<SectionState>(SectionState::Complete);
+		ring.section_valid_LOD[pos.x][pos.y] = new std::atomic<int>(0);
+		ring.thread_pool[pos.x][pos.y] = nullptr;
+		return;
+	}
+	if (restoreCachedSection(MemoryClass::Sections, ring_index, sectionTile(origin), ring.thread_pool[pos.x][pos.y], ring.section_state[pos.x][pos.y],
+		ring.section_valid_LOD[pos.x][pos.y], ring.point_sections[pos.x][pos.y], ring.color_sections[pos.x][pos.y]))
+	{
+		setSectionPriority(ring, pos.x, pos.y);
+		return;
+	}
+	for (auto it = section_prefetches.begin(); it != section_prefetches.end(); ++it)
+	{
+		/*Adopt a prefetched section with its loader, the loader is promoted to the priority of its slot*/
+		if (it->ring == ring_index && it->tile == sectionTile(origin))
+		{
+			ring.point_sections[pos.x][pos.y] = it->point_section;
+			ring.color_sections[pos.x][pos.y] = it->color_section;
+			ring.section_state[pos.x][pos.y] = it->state;
+			ring.section_valid_LOD[pos.x][pos.y] = it->valid_LOD;
+			ring.thread_pool[pos.x][pos.y] = it->thread;
+			section_prefetches.erase(it);
+			transferMemory(MemoryClass::Prefetch, MemoryClass::Sections, sectionBytes());
+			setSectionPriority(ring, pos.x, pos.y);
+			return;
+		}
+	}
+	ring.point_sections[pos.x][pos.y] = new float[stride_x * point_buffer_resolution.x * point_buffer_resolution.y]();
+	ring.color_sections[pos.x][pos.y] = new CudaSpace::PackedColor[stride_x * point_buffer_resolution.x * point_buffer_resolution.y]();
+	trackMemory(MemoryClass::Sections, sectionBytes());
+	ring.section_state[pos.x][pos.y] = new std::atomic<SectionState>(SectionState::Loading);
+	ring.section_valid_LOD[pos.x][pos.y] = new std::atomic<int>(LOD_levels - 1);
+	ring.thread_pool[pos.x][pos.y] = new std::thread(loadLASToSection, origin, ring.scale, ring.section_state[pos.x][pos.y], ring.section_valid_LOD[pos.x][pos.y], ring.point_sections[pos.x][pos.y], ring.color_sections[pos.x][pos.y]);
+	setSectionPriority(ring, pos.x, pos.y);
+}
+
+/*
+ * Cancel the loader of a section still loading, which then frees it, or move a complete section to the cache
+ * owner is the class the section's memory is accounted to
+ */
+void releaseSection(MemoryClass owner, int ring, glm::ivec2 tile, std::thread *thread, std::atomic<SectionState> *state, std::atomic<int> *valid_LOD, float *point_section, CudaSpace::PackedColor *color_section)
+{
+	SectionState loading = SectionState::Loading;
+	if (state->compare_exchange_strong(loading, SectionState::Cancelled))
+	{
+		/*The loader frees the buffers once it notices, until then they are accounted as cancelled outside of the budget*/
+		transferMemory(owner, MemoryClass::Cancelled, sectionBytes());
+		/*Detach to let the thread end on its own after the object has been deleted*/
+		thread->detach();
+		delete thread;
+		return;
+	}
+
+	/*The loader of a complete section has returned or is about to*/
+	if (thread != nullptr)
+	{
+		thread->join();
+		delete thread;
+	}
+	if (section_cache_budget > 0)
+	{
+		transferMemory(owner, MemoryClass::Cache, sectionBytes());
+		cacheSection(ring, tile, point_section, color_section);
+	}
+	else
+	{
+		trackMemory(owner, -static_cast<long long>(sectionBytes()));
+		delete[] point_section;
+		delete[] color_section;
+	}
+	delete state;
+	delete valid_LOD;
+}
+
+/*
+ * Release a section of a ring
+ */
+void unloadSection(SectionRing& ring, int x, int y)
+{
+	/*Covered sections own no buffers*/
+	if (ring.covered[x][y])
+	{
+		delete ring.section_state[x][y];
+		delete ring.section_valid_LOD[x][y];
+		return;
+	}
+	releaseSection(MemoryClass::Sections, static_cast<int>(&ring - section_rings), sectionTile(ring.point_sections_origins[x][y]), ring.thread_pool[x][y],
+		ring.section_state[x][y], ring.section_valid_LOD[x][y], ring.point_sections[x][y], ring.color_sections[x][y]);
+}
+
+/*
+ * Compute the LOD layout of a grid from its finest resolution, coarsest level first like the point sections
+ * The whole grid is marked as loaded and as a single section
+ */
+void setupGridPyramid(CudaSpace::GridPyramid& grid, int resolution, int levels, float scale)
+{
+	grid.LOD_levels = levels;
+	grid.LOD_resolutions[levels - 1] = resolution >> (levels - 1);
+	grid.LOD_indexes[levels - 1] = 0;
+	for (auto i = levels - 2; i >= 0; i--)
+	{
+		grid.LOD_indexes[i] = grid.LOD_indexes[i + 1] + grid.LOD_resolutions[i + 1] * grid.LOD_resolutions[i + 1];
+		grid.LOD_resolutions[i] = grid.LOD_resolutions[i + 1] * 2;
+	}
+	grid.origin = glm::vec2(0, 0);
+	grid.scale = scale;
+	grid.valid_LOD = glm::ivec4(0);
+	grid.section_split = glm::ivec2(resolution, resolution);
+}
+
+/*
+ * Size the whole dataset overview so that it fits overview_max_resolution and start loading it
+ * Its cells are a power of two of the finest cells so it lines up with the point buffer
+ */
+void initializeOverview()
+{
+	float extent = glm::max(boundaries.x, boundaries.y);
+	float scale = 1;
+	while (extent / scale > overview_max_resolution)
+		scale *= 2;
+
+	/*Round the resolution up so that the coarsest level covers the whole dataset*/
+	int coarsest = static_cast<int>(glm::ceil(extent / scale / (1 << (overview_LOD_levels - 1))));
+	setupGridPyramid(overview_grid, glm::max(coarsest, 1) << (overview_LOD_levels - 1), overview_LOD_levels, scale);
+	overview_size = overview_grid.LOD_indexes[0] + overview_grid.LOD_resolutions[0] * overview_grid.LOD_resolutions[0];
+
+	h_overview_heights = new float[overview_size]();
+	h_overview_colors = new CudaSpace::PackedColor[overview_size]();
+	trackMemory(MemoryClass::Overview, (sizeof(float) + sizeof(CudaSpace::PackedColor)) * overview_size);
+	checkCudaErrors(cudaMalloc(&overview_grid.heights, sizeof(float) * overview_size));
+	checkCudaErrors(cudaMalloc(&overview_grid.colors, sizeof(CudaSpace::PackedColor) * overview_size));
+
+	overview_thread = new std::thread(loadLASToOverview);
+	SetThreadPriority(overview_thread->native_handle(), -2);
+}
+
+/* 
+ * Spawn threads at the initialization phase to start loading points 
+ * The camera starts in the section right of and above the center of the sections grid (readLASHeader() must be called before this function)
+ * Origins are aligned to whole section extents so that revisited sections can be found in the cache
+ */
+void initializeSections(SectionRing& ring)
+{
+	glm::vec2 section_extent = static_cast<float>(glm::pow(2.0f, LOD_levels - 1)) * glm::vec2(point_buffer_resolution);
+	glm::vec2 camera = glm::floor(glm::vec2(camera_position.x, camera_position.z) / ring.scale / section_extent) * section_extent;
+	for(int i = 0; i < point_sections_size; i++)
+	{
+		for (int j = 0; j < point_sections_size; j++)
+		{
+			allocateSection(ring, glm::ivec2(i, j),
+				camera +
+				glm::vec2((i - static_cast<float>(point_sections_size) / 2.0f) * glm::pow(2.0f, LOD_levels - 1) * static_cast<float>(point_buffer_resolution.x),
+						  (j - static_cast<float>(point_sections_size) / 2.0f) * glm::pow(2.0f, LOD_levels - 1) * static_cast<float>(point_buffer_resolution.y)));
+		}
+	}
+
+}
+
+/*
+ * Helper function for manageSections
+ */
+void unloadSectionsColumn(SectionRing& ring, int column)
+{
+	for(int i = 0; i < point_sections_size; i++)
+		unloadSection(ring, column, i);
+}
+
+
+/*
+* Helper function for manageSections
+*/
+void unloadSectionsRow(SectionRing& ring, int row)
+{
+	for (int i = 0; i < point_sections_size; i++)
+		unloadSection(ring, i, row);
+}
+
+/*
+* Move a section of a ring to another slot of the same ring
+*/
+void moveSection(SectionRing& ring, int i, int j, int from_i, int from_j)
+{
+	ring.point_sections[i][j] = ring.point_sections[from_i][from_j];
+	ring.color_sections[i][j] = ring.color_sections[from_i][from_j];
+	ring.point_sections_origins[i][j] = ring.point_sections_origins[from_i][from_j];
+	ring.covered[i][j] = ring.covered[from_i][from_j];
+	ring.thread_pool[i][j] = ring.thread_pool[from_i][from_j];
+	ring.section_state[i][j] = ring.section_state[from_i][from_j];
+	ring.section_valid_LOD[i][j] = ring.section_valid_LOD[from_i][from_j];
+	setSectionPriority(ring, i, j);
+}
+
+/*
+* Move sections X cells horizontally
+* + is RIGHT
+*/
+void rearrangeSectionsX(SectionRing& ring, int x)
+{
+	int i, j;
+	if (x >= 0)
+	{
+		for (i = point_sections_size - 1; i >= x; i--)
+			for (j = 0; j < point_sections_size; j++)
+				moveSection(ring, i, j, i - x, j);
+	}
+	else
+	{
+		for (i = 0; i < point_sections_size + x; i++)
+			for (j = 0; j < point_sections_size; j++)
+				moveSection(ring, i, j, i - x, j);
+	}
+}
+
+/*
+* Move sections Y cells vertically
+* + is DOWN
+*/
+void rearrangeSectionsY(SectionRing& ring, int y)
+{
+	int i, j;
+	if (y >= 0)
+	{
+		for (i = 0; i < point_sections_size; i++)
+			for (j = point_sections_size - 1; j >= y; j--)
+				moveSection(ring, i, j, i, j - y);
+	}
+	else
+	{
+		for (i = 0; i < point_sections_size; i++)
+			for (j = 0; j < point_sections_size + y; j++)
+				moveSection(ring, i, j, i, j - y);
+	}
+}
+
+/* 
+ * Based on camera position, load and unload the point sections of a ring
+ * If the camera's grid is less than the set distance to a border, rearrange the grid
+ */
+void manageSections(SectionRing& ring)
+{
+	glm::vec2 camera = glm::vec2(camera_position.x, camera_position.z) / ring.scale;
+
+	/*Allocate left - move sections right*/
+	if (camera.x < ring.point_sections_origins[1][0].x)
+	{
+		long long shift_start = traceTimestamp();
+		unloadSectionsColumn(ring, point_sections_size - 1);
+		rearrangeSectionsX(ring, 1);
+		for (int i = 0; i < point_sections_size; i++)
+			allocateSection(ring, glm::ivec2(0, i),
+				ring.point_sections_origins[1][i] - glm::vec2(1, 0) * static_cast<float>(point_buffer_resolution.x) *  glm::pow(2.0f, LOD_levels - 1));
+		traceComplete("shift ring left", shift_start, traceTimestamp() - shift_start, "scale", static_cast<long long>(ring.scale));
+	}
+
+	/*Allocate right - Move sections left*/
+	if (camera.x >= ring.point_sections_origins[point_sections_size - 1][point_sections_size - 1].x)
+	{
+		long long shift_start = traceTimestamp();
+		unloadSectionsColumn(ring, 0);
+		rearrangeSectionsX(ring, -1);
+		for (int i = 0; i < point_sections_size; i++)
+			allocateSection(ring, glm::ivec2(point_sections_size - 1, i),
+				ring.point_sections_origins[point_sections_size - 2][i] + glm::vec2(1, 0) * static_cast<float>(point_buffer_resolution.x) * glm::pow(2.0f, LOD_levels - 1));
+		traceComplete("shift ring right", shift_start, traceTimestamp() - shift_start, "scale", static_cast<long long>(ring.scale));
+	}
+
+	/*Allocate down - move sections up*/
+	if (camera.y < ring.point_sections_origins[0][1].y)
+	{
+		long long shift_start = traceTimestamp();
+		unloadSectionsRow(ring, point_sections_size - 1);
+		rearrangeSectionsY(ring, 1);
+		for (int i = 0; i < point_sections_size; i++)
+			allocateSection(ring, glm::ivec2(i, 0),
+				ring.point_sections_origins[i][1] - glm::vec2(0, 1) * static_cast<float>(point_buffer_resolution.y) * glm::pow(2.0f, LOD_levels - 1));
+		traceComplete("shift ring down", shift_start, traceTimestamp() - shift_start, "scale", static_cast<long long>(ring.scale));
+	}
+
+	/*Allocate up - move sections down*/
+	if (camera.y >= ring.point_sections_origins[0][point_sections_size - 1].y)
+	{
+		long long shift_start = traceTimestamp();
+		unloadSectionsRow(ring, 0);
+		rearrangeSectionsY(ring, -1);
+		for (int i = 0; i < point_sections_size; i++)
+			allocateSection(ring, glm::ivec2(i, point_sections_size - 1),
+				ring.point_sections_origins[i][point_sections_size - 2] + glm::vec2(0, 1) * static_cast<float>(point_buffer_resolution.y) * glm::pow(2.0f, LOD_levels - 1));
+		traceComplete("shift ring up", shift_start, traceTimestamp() - shift_start, "scale", static_cast<long long>(ring.scale));
+	}
+}
+
+/*
+ * Load the sections of an outer ring the inner ring no longer covers and release the ones it now covers
+ */
+void updateCoverage(SectionRing& ring)
+{
+	int ring_index = static_cast<int>(&ring - section_rings);
+	for (int x = 0; x < point_sections_size; x++)
+		for (int y = 0; y < point_sections_size; y++)
+		{
+			glm::vec2 origin = ring.point_sections_origins[x][y];
+			if (sectionCovered(ring_index, sectionTile(origin)) != ring.covered[x][y])
+			{
+				unloadSection(ring, x, y);
+				allocateSection(ring, glm::ivec2(x, y), origin);
+			}
+		}
+}
+
+/*
+ * Start loading at low priority the sections of the rings around the camera position extrapolated prefetch_horizon seconds ahead
+ * The velocity is turned by the current yaw rate over half the horizon to follow curved flights
+ * Prefetched sections that leave the extrapolated rings are released like evicted ones
+ */
+void prefetchSections()
+{
+	if (prefetch_horizon <= 0)
+		return;
+	glm::vec2 section_extent = static_cast<float>(glm::pow(2.0f, LOD_levels - 1)) * glm::vec2(point_buffer_resolution);
+	glm::vec2 displacement = glm::rotate(camera_velocity * prefetch_horizon, -camera_yaw_rate * prefetch_horizon / 2); // (x, z) turns the other way than around +Y
+	glm::vec2 predicted = glm::vec2(camera_position.x, camera_position.z) + displacement;
+	int running = 0;
+	for (PrefetchedSection const& section : section_prefetches)
+		if (*section.state == SectionState::Loading)
+			running++;
+
+	for (int r = 0; r < section_ring_count; r++)
+	{
+		SectionRing& ring = section_rings[r];
+		glm::ivec2 predicted_tile = glm::ivec2(glm::floor(predicted / ring.scale / section_extent));
+
+		/*Release the prefetches the extrapolated camera no longer needs*/
+		for (auto it = section_prefetches.begin(); it != section_prefetches.end();)
+		{
+			glm::ivec2 distance = it->tile - predicted_tile;
+			if (it->ring == r && (distance.x < -point_sections_size / 2 || distance.x >= point_sections_size / 2 || distance.y < -point_sections_size / 2 || distance.y >= point_sections_size / 2))
+			{
+				if (*it->state == SectionState::Loading)
+					running--;
+				releaseSection(MemoryClass::Prefetch, it->ring, it->tile, it->thread, it->state, it->valid_LOD, it->point_section, it->color_section);
+				it = section_prefetches.erase(it);
+			}
+			else
+				++it;
+		}
+
+		/*Start the sections of the extrapolated ring that are neither resident, cached nor prefetched*/
+		for (int i = -point_sections_size / 2; i < point_sections_size / 2; i++)
+			for (int j = -point_sections_size / 2; j < point_sections_size / 2; j++)
+			{
+				if (running >= prefetch_max_sections || !memoryAvailable(sectionBytes()))
+					return;
+				glm::ivec2 tile = predicted_tile + glm::ivec2(i, j);
+				glm::vec2 origin = glm::vec2(tile) * section_extent;
+				if (tile.x < 0 || tile.y < 0 || origin.x * ring.scale >= boundaries.x || origin.y * ring.scale >= boundaries.y || sectionCovered(r, tile))
+					continue;
+				bool known = false;
+				for (int x = 0; x < point_sections_size && !known; x++)
+					for (int y = 0; y < point_sections_size && !known; y++)
+						known = sectionTile(ring.point_sections_origins[x][y]) == tile;
+				for (auto it = section_prefetches.begin(); it != section_prefetches.end() && !known; ++it)
+					known = it->ring == r && it->tile == tile;
+				if (known)
+					continue;
+
+				/*Cached sections are unpacked ahead, the others are loaded*/
+				PrefetchedSection section;
+				section.ring = r;
+				section.tile = tile;
+				if (!restoreCachedSection(MemoryClass::Prefetch, r, tile, section.thread, section.state, section.valid_LOD, section.point_section, section.color_section))
+				{
+					section.point_section = new float[stride_x * point_buffer_resolution.x * point_buffer_resolution.y]();
+					section.color_section = new CudaSpace::PackedColor[stride_x * point_buffer_resolution.x * point_buffer_resolution.y]();
+					trackMemory(MemoryClass::Prefetch, sectionBytes());
+					section.state = new std::atomic<SectionState>(SectionState::Loading);
+					section.valid_LOD = new std::atomic<int>(LOD_levels - 1);
+					section.thread = new std::thread(loadLASToSection, origin, ring.scale, section.state, section.valid_LOD, section.point_section, section.color_section);
+				}
+				if (section.thread != nullptr)
+				{
+					SetThreadPriority(section.thread->native_handle(), -2);
+					running++;
+				}
+				section_prefetches.push_back(section);
+			}
+	}
+}
+
+/*
+ * Bring the host memory back into the budget, first by evicting cached sections then by dropping the latest prefetches
+ * The rings themselves are never shrunk, exceeding the budget with them alone is reported once
+ */
+void enforceMemoryBudget()
+{
+	while (!memoryAvailable(0))
+	{
+		if (!section_cache.empty())
+			evictCachedSection();
+		else if (!section_prefetches.empty())
+		{
+			/*A complete prefetch goes to the cache and is evicted on the next iteration*/
+			PrefetchedSection const& section = section_prefetches.back();
+			releaseSection(MemoryClass::Prefetch, section.ring, section.tile, section.thread, section.state, section.valid_LOD, section.point_section, section.color_section);
+			section_prefetches.pop_back();
+		}
+		else
+		{
+			if (!memory_over_budget)
+			{
+				std::cout << "Resident sections exceed the memory budget" << std::endl;
+				printMemoryUsage();
+			}
+			memory_over_budget = true;
+			return;
+		}
+	}
+	memory_over_budget = false;
+}
+
+/*
+ * Load and unload the point sections of every ring and prefetch the ones ahead of the camera within the memory budget
+ */
+void manageSections()
+{
+	for (int i = 0; i < section_ring_count; i++)
+	{
+		manageSections(section_rings[i]);
+		if (i > 0)
+			updateCoverage(section_rings[i]);
+	}
+	enforceMemoryBudget();
+	prefetchSections();
+}
+
+
+/*
+* Set up CPU-Side buffer of a ring that is going to be transferred over to the GPU and place its grid in the dataset
+*
+* NOTE: it is more efficient to pre-allocate the point
+* buffer in the RAM and then pass it to the GPU
+* than passing every line at a time
+*
+*/
+void preparePointBuffer(SectionRing& ring, CudaSpace::GridPyramid& grid)
+{
+	int ring_index = static_cast<int>(&ring - section_rings);
+	glm::vec2 bottom_left, top_right, offset, camera;
+	int minX, maxX, minY, maxY;
+	float* h_point_buffer = ring.h_point_buffer;
+	CudaSpace::PackedColor* h_color_map = ring.h_color_map;
+
+	/*Set the corners of the point buffer*/
+	offset =
+		glm::vec2(glm::pow(2.0f, LOD_levels - 1) * point_buffer_resolution.x / 2.0f,
+		glm::pow(2.0f, LOD_levels - 1) * point_buffer_resolution.y / 2.0f);
+
+	camera = glm::vec2(camera_position.x, camera_position.z) / ring.scale;
+	bottom_left = camera - offset;
+	top_right = camera + offset - glm::vec2(FLT_MIN, FLT_MIN); //subtract an amount in case the camera is at the center of a grid 
+
+	/*Left section index*/
+	minX = 0;
+	while(bottom_left.x > ring.point_sections_origins[minX][0].x && minX < point_sections_size)
+	{
+		minX++;
+	}
+	minX--;
+
+	/*Bottom section index*/
+	minY = 0;
+	while (bottom_left.y > ring.point_sections_origins[0][minY].y && minY < point_sections_size)
+	{
+		minY++;
+	}
+	minY--;
+
+	/*Right section index*/
+	maxX = 0;
+	while(top_right.x > ring.point_sections_origins[maxX][0].x && maxX < point_sections_size)
+	{
+		maxX++;
+	}
+	maxX--;
+
+	/*Top section index*/
+	maxY = 0;
+	while (top_right.y > ring.point_sections_origins[0][maxY].y && maxY < point_sections_size)
+	{
+		maxY++;
+	}
+	maxY--;
+
+	/*Copy the quad-trees into the point buffer, start with lower left corner and proceed row-wise */
+	glm::vec2 section_position;
+	glm::ivec2 cell_position;
+	int row_index, row_offset;
+
+	/*Section position at lower left section*/
+	section_position = bottom_left - ring.point_sections_origins[minX][minY];
+	cell_position = glm::ivec2(static_cast<int>(glm::floor(section_position.x / glm::pow(2.0f, LOD_levels - 1))), static_cast<int>(glm::floor(section_position.y / glm::pow(2.0f, LOD_levels - 1))));
+
+	for (int i = LOD_levels - 1; i >= 0; i--)
+	{
+		/*Copy the data from the lower left section*/
+		row_offset = 0;
+		for (row_index = cell_position.y; row_index < LOD_resolutions[i]; row_index++)
+		{
+			copySectionRow(ring_index, glm::ivec2(minX, minY), i, row_index, cell_position.x, LOD_resolutions[i] - cell_position.x, 1,
+				h_point_buffer + LOD_indexes[i] + row_offset * LOD_resolutions[i],
+				h_color_map + LOD_indexes[i] + row_offset * LOD_resolutions[i]);
+
+			row_offset++;
+		}
+
+		/*Copy the data from the bottom right section*/
+		row_offset = 0;
+		row_index = cell_position.x == 0 ? LOD_resolutions[i] : cell_position.y;
+		for (row_index; row_index < LOD_resolutions[i]; row_index++)
+		{
+			copySectionRow(ring_index, glm::ivec2(maxX, minY), i, row_index, 0, cell_position.x, 1,
+				h_point_buffer + LOD_indexes[i] + (LOD_resolutions[i] - cell_position.x) + row_offset * LOD_resolutions[i],
+				h_color_map + LOD_indexes[i] + (LOD_resolutions[i] - cell_position.x) + row_offset * LOD_resolutions[i]);
+
+			row_offset++;
+		}
+
+		/*Copy the data from top left section */
+		row_offset = 0;
+		row_index = cell_position.y == 0 ? cell_position.y : 0;
+		for (row_index; row_index < cell_position.y; row_index++)
+		{
+			copySectionRow(ring_index, glm::ivec2(minX, maxY), i, row_offset, cell_position.x, LOD_resolutions[i] - cell_position.x, 1,
+				h_point_buffer + LOD_indexes[i] + (row_index + LOD_resolutions[i] - cell_position.y) * LOD_resolutions[i],
+				h_color_map + LOD_indexes[i] + (row_index + LOD_resolutions[i] - cell_position.y) * LOD_resolutions[i]);
+
+			row_offset++;
+		}
+
+		/*Copy the data from top right section*/
+		row_offset = 0;
+		row_index = cell_position.y == 0 || cell_position.x == 0 ? cell_position.y : 0;
+		for (row_index; row_index < cell_position.y; row_index++)
+		{
+			copySectionRow(ring_index, glm::ivec2(maxX, maxY), i, row_offset, 0, cell_position.x, 1,
+				h_point_buffer + LOD_indexes[i] + (LOD_resolutions[i] - cell_position.x) + (row_index + LOD_resolutions[i] - cell_position.y) * LOD_resolutions[i],
+				h_color_map + LOD_indexes[i] + (LOD_resolutions[i] - cell_position.x) + (row_index + LOD_resolutions[i] - cell_position.y) * LOD_resolutions[i]);
+
+			row_offset++;
+		}
+		if(i > 0)
+			cell_position *= 2;
+	}
+
+	/*Place the point buffer in the dataset, sections split it on coarsest cell borders so a cell never mixes two sections*/
+	grid.origin = (ring.point_sections_origins[minX][minY] + glm::vec2(cell_position)) * ring.scale;
+	grid.section_split = glm::ivec2(LOD_resolutions[0], LOD_resolutions[0]) - cell_position;
+	grid.valid_LOD = glm::ivec4(sectionValidLOD(ring_index, glm::ivec2(minX, minY)), sectionValidLOD(ring_index, glm::ivec2(maxX, minY)),
+		sectionValidLOD(ring_index, glm::ivec2(minX, maxY)), sectionValidLOD(ring_index, glm::ivec2(maxX, maxY)));
+}
+
+/*
+ * Assemble the point buffer of every ring, the rings are the first grids traversed by the rays
+ */
+void preparePointBuffer()
+{
+	for (int i = 0; i < section_ring_count; i++)
+		preparePointBuffer(section_rings[i], grids[i]);
+}
+
+void copyPointBuffer()
+{
+	/*Send the point buffer of every ring to the gpu*/
+	for (int i = 0; i < section_ring_count; i++)
+	{
+		checkCudaErrors(cudaMemcpy(section_rings[i].d_point_buffer, section_rings[i].h_point_buffer, sizeof(float) * point_buffer_resolution.x * stride_x * point_buffer_resolution.y, cudaMemcpyHostToDevice));
+		checkCudaErrors(cudaMemcpy(section_rings[i].d_color_map, section_rings[i].h_color_map, sizeof(CudaSpace::PackedColor) * point_buffer_resolution.x * stride_x * point_buffer_resolution.y, cudaMemcpyHostToDevice));
+	}
+
+	/*Send the overview until it has been sent once complete*/
+	if (use_overview && !overview_uploaded)
+	{
+		bool complete = overview_complete;
+		checkCudaErrors(cudaMemcpy(overview_grid.heights, h_overview_heights, sizeof(float) * overview_size, cudaMemcpyHostToDevice));
+		checkCudaErrors(cudaMemcpy(overview_grid.colors, h_overview_colors, sizeof(CudaSpace::PackedColor) * overview_size, cudaMemcpyHostToDevice));
+		overview_uploaded = complete;
+	}
+}
+/*
+ * This method sets up a texture object and its respective buffers to share with CUDA device
+ *
+ * GL_TEXTURE_RECTANGLE is used to avoid generating mip maps and wasting resources
+ * Sources: 
+ * https://www.khronos.org/opengl/wiki/Rectangle_Texture
+ * http://www.songho.ca/opengl/gl_pbo.html
+ *
+ */
+void setupTexture()
+{
+	// Generate a buffer ID
+	glGenBuffers(1, &bufferID);
+	// Make this the current UNPACK buffer (OpenGL is state-based)
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, bufferID);
+	// Allocate data for the buffer. 4-channel 8-bit image
+	glBufferData(GL_PIXEL_UNPACK_BUFFER, texture_resolution.x * texture_resolution.y * 3, NULL, GL_DYNAMIC_COPY);
+	// Registers the buffer object specified by buffer for access by CUDA.A handle to the registered object is returned as resource.
+	// Source: http://docs.nvidia.com/cuda/cuda-runtime-api/group__CUDART__OPENGL.html#group__CUDART__OPENGL_1g0fd33bea77ca7b1e69d1619caf44214b
+	checkCudaErrors(cudaGraphicsGLRegisterBuffer(&cuda_pbo_resource, bufferID, cudaGraphicsRegisterFlagsNone));
+
+	// Enable Texturing
+	glEnable(GL_TEXTURE_RECTANGLE);
+	// Generate a texture ID
+	glGenTextures(1, &textureID);
+	// Make this the current texture (remember that GL is state-based)
+	glBindTexture(GL_TEXTURE_RECTANGLE, textureID);
+	// Allocate the texture memory. The last parameter is NULL since we only want to allocate memory, not initialize it
+	// https://www.khronos.org/opengl/wiki/GLAPI/glTexBuffer
+	glTexImage2D(GL_TEXTURE_RECTANGLE, 0, GL_RGB8, texture_resolution.x, texture_resolution.y, 0, GL_RGB, GL_UNSIGNED_BYTE, NULL);
+
+	// Must set the filter mode to avoid any altering in the resulting image and reduce performance cost
+	glTexParameteri(GL_TEXTURE_RECTANGLE, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_RECTANGLE, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_RECTANGLE, GL_TEXTURE_WRAP_S, GL_CLAMP);
+	glTexParameteri(GL_TEXTURE_RECTANGLE, GL_TEXTURE_WRAP_T, GL_CLAMP);
+
+	// Unbind texture and buffer
+	glBindTexture(GL_TEXTURE_RECTANGLE, 0);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+
+//============================
+//		OPENGL FUNCTIONS
+//============================
+/*
+ * Update the texture with raytracing data from the GPU
+ */
+void updateTexture()
+{
+	//Synchronize OpenGL and CPU calls before locking and working on the buffer object
+	checkCudaErrors(cudaGraphicsMapResources(1, &cuda_pbo_resource, 0));
+
+	//Get a pointer to the memory position in the CUDA device (GPU)
+	unsigned char* devPtr;
+	size_t size;
+	checkCudaErrors(cudaGraphicsResourceGetMappedPointer(reinterpret_cast<void **>(&devPtr), &size, cuda_pbo_resource));
+
+	//Call the wrapper function invoking the CUDA Kernel
+	CudaSpace::rayTrace(texture_resolution, frame_dimension, camera_forward, camera_position, devPtr, use_color_map, max_height, grids, grid_count,
+		heatmap_mode, &traversal_statistics);
+
+	//Synchronize CUDA calls and release the buffer for OpenGL and CPU use;
+	checkCudaErrors(cudaGraphicsUnmapResources(1, &cuda_pbo_resource, 0));
+}
+
+/*
+ * Copy pixel data to a texture and display it on screen
+ */
+void renderTexture()
+{
+	int width = glutGet(GLUT_WINDOW_WIDTH),
+		height = glutGet(GLUT_WINDOW_HEIGHT);
+
+	// Copy texture data from buffer;
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, bufferID);
+	glBindTexture(GL_TEXTURE_RECTANGLE, textureID);
+	glTexSubImage2D(GL_TEXTURE_RECTANGLE, 0, 0, 0, texture_resolution.x, texture_resolution.y, GL_RGB, GL_UNSIGNED_BYTE, NULL);
+
+
+	// Adjust coordinate system to screen position
+	glMatrixMode(GL_PROJECTION);
+	glPushMatrix();
+	glLoadIdentity();
+	glOrtho(0.0, width, 0.0, height, -1.0, 1.0);
+	glMatrixMode(GL_MODELVIEW);
+	glPushMatrix();
+
+
+	// Draw a quad and apply texture
+	glEnable(GL_TEXTURE_RECTANGLE);
+	{
+		glBegin(GL_QUADS);
+
+		glTexCoord2i(0, 0); 
+		glVertex2i(0, 0);
+
+		glTexCoord2i(texture_resolution.x, 0);	
+		glVertex2i(width, 0);
+
+		glTexCoord2i(texture_resolution.x, texture_resolution.y);
+		glVertex2i(width, height);
+
+		glTexCoord2i(0, texture_resolution.y);
+		glVertex2i(0, height);
+		glEnd();
+	}
+	glDisable(GL_TEXTURE_RECTANGLE);
+
+	// Unbind buffer and texture
+	glBindTexture(GL_TEXTURE_RECTANGLE, 0);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+	glPopMatrix();
+	glMatrixMode(GL_PROJECTION);
+	glPopMatrix();
+	glMatrixMode(GL_MODELVIEW);
+}
+
+
+//============================
+//		CAMERA FUNCTIONS
+//============================
+
+/*
+ * Time step of the camera movement, fixed when requested so that recordings do not depend on the frame rate
+ */
+float frameTimeStep()
+{
+	return fixed_time_step > 0 ? fixed_time_step : delta_time.count();
+}
+
+/*
+ *Handle the camera movement
+ */
+void moveCamera()
+{
+	float factor = frameTimeStep() > 1 ? 1 : frameTimeStep();
+	glm::vec3 previous_position = camera_position;
+	camera_position += factor * (glm::vec3(0, movement_up, 0) + glm::normalize(glm::vec3(camera_forward.x, 0, camera_forward.z)) * movement_fwd + glm::normalize(glm::cross(camera_forward, glm::vec3(0, 1, 0))) * movement_rht);
+	
+	if (camera_position.x < 0)
+		camera_position.x = 0;
+	if (camera_position.x >= boundaries.x)
+		camera_position.x = boundaries.x - 0.00001f;
+
+	if (camera_position.z < 0)
+		camera_position.z = 0;
+	if (camera_position.z >= boundaries.y)
+		camera_position.z = boundaries.y - 0.00001f;
+
+	if (camera_position.y < 0)
+		camera_position.y = 0;
+	if (camera_position.y >= max_height * 4)
+		camera_position.y = max_height * 4;
+
+	/*Smooth the velocity so that a single slow frame does not redirect the prefetch*/
+	if (factor > 0)
+		camera_velocity = glm::mix(camera_velocity, glm::vec2(camera_position.x - previous_position.x, camera_position.z - previous_position.z) / factor, 0.25f);
+}
+/*
+ * Handle camera rotation
+ */
+void rotateCamera()
+{
+
+	camera_yaw_rate = rotation_up;
+	camera_forward = glm::rotate(camera_forward, rotation_up * frameTimeStep(), glm::vec3(0, 1, 0));
+	camera_forward = glm::rotate(camera_forward, rotation_right * frameTimeStep(), glm::normalize(glm::cross(camera_forward, glm::vec3(0, 1, 0))));
+}
+
+
+//============================
+//		CAMERA PATH
+//============================
+
+/*
+ * Returns true once every section of the rings and the overview are completely loaded
+ */
+bool sectionsLoaded()
+{
+	for (int i = 0; i < section_ring_count; i++)
+		for (int x = 0; x < point_sections_size; x++)
+			for (int y = 0; y < point_sections_size; y++)
+				if (*section_rings[i].section_state[x][y] != SectionState::Complete)
+					return false;
+	return !use_overview || overview_uploaded;
+}
+
+/*
+ * Write the camera path to camera_path_file, one frame per line: time step, position, forward, velocity and yaw rate
+ */
+void saveCameraPath()
+{
+	std::ofstream ofs(camera_path_file);
+	if (!ofs.is_open())
+	{
+		std::cout << "Error writing " << camera_path_file << std::endl;
+		return;
+	}
+	ofs.precision(9);
+	for (CameraPathFrame const& frame : camera_path)
+		ofs << frame.time_step << " " << frame.position.x << " " << frame.position.y << " " << frame.position.z << " "
+			<< frame.forward.x << " " << frame.forward.y << " " << frame.forward.z << " "
+			<< frame.velocity.x << " " << frame.velocity.y << " " << frame.yaw_rate << std::endl;
+	std::cout << "Camera path of " << camera_path.size() << " frames written to " << camera_path_file << std::endl;
+}
+
+bool loadCameraPath()
+{
+	std::ifstream ifs(camera_path_file);
+	if (!ifs.is_open())
+	{
+		std::cout << "Error opening " << camera_path_file << std::endl;
+		return false;
+	}
+	camera_path.clear();
+	CameraPathFrame frame;
+	while (ifs >> frame.time_step >> frame.position.x >> frame.position.y >> frame.position.z >> frame.forward.x >> frame.forward.y >> frame.forward.z
+		>> frame.velocity.x >> frame.velocity.y >> frame.yaw_rate)
+		camera_path.push_back(frame);
+	return !camera_path.empty();
+}
+
+/*
+ * Start recording the camera state of every frame, or stop and write the path
+ */
+void toggleCameraRecording()
+{
+	if (camera_path_mode == CameraPathMode::Replay)
+		return;
+	if (camera_path_mode == CameraPathMode::Record)
+	{
+		camera_path_mode = CameraPathMode::Off;
+		saveCameraPath();
+		return;
+	}
+	camera_path.clear();
+	camera_path_mode = CameraPathMode::Record;
+	std::cout << "Recording the camera path" << (fixed_time_step > 0 ? " with fixed time steps" : "") << std::endl;
+}
+
+/*
+ * Append the camera state of the current frame to the recorded path
+ */
+void recordCameraPathFrame()
+{
+	if (camera_path_mode != CameraPathMode::Record)
+		return;
+	camera_path.push_back({ frameTimeStep(), camera_position, camera_forward, camera_velocity, camera_yaw_rate });
+}
+
+/*
+ * Write the stage timings of every replayed frame to replay_timing_file and print the percentiles of the frame times
+ */
+void writeReplayTiming()
+{
+	std::vector<float> frame_times;
+	if (!replay_timing_file.empty())
+	{
+		std::ofstream csv(replay_timing_file);
+		csv << "frame";
+		for (int i = 0; i < static_cast<int>(FrameStage::Count); i++)
+			csv << "," << frame_stage_names[i] << "_ms";
+		csv << std::endl;
+		for (std::size_t frame = 0; frame < replay_timings.size(); frame++)
+		{
+			csv << frame;
+			for (float time : replay_timings[frame].stages)
+				csv << "," << time;
+			csv << std::endl;
+		}
+	}
+	for (ReplayFrameTiming const& timing : replay_timings)
+		frame_times.push_back(timing.stages[static_cast<int>(FrameStage::Frame)]);
+	if (frame_times.empty())
+		return;
+	std::sort(frame_times.begin(), frame_times.end());
+	std::cout << "Replayed " << frame_times.size() << " frames, frame time p50 " << frame_times[frame_times.size() / 2] << " ms, p95 " << frame_times[frame_times.size() * 95 / 100]
+		<< " ms, max " << frame_times.back() << " ms, " << replay_wait_frames << " frames waited for sections" << std::endl;
+}
+
+/*
+ * Replay the camera path from camera_path_file, or stop the running replay
+ */
+void toggleCameraReplay()
+{
+	if (camera_path_mode == CameraPathMode::Record)
+		return;
+	if (camera_path_mode == CameraPathMode::Replay)
+	{
+		camera_path_mode = CameraPathMode::Off;
+		writeReplayTiming();
+		return;
+	}
+	if (!loadCameraPath())
+		return;
+	replay_frame = 0;
+	replay_wait_frames = 0;
+	replay_frame_counted = false;
+	replay_timings.clear();
+	camera_path_mode = CameraPathMode::Replay;
+	std::cout << "Replaying " << camera_path.size() << " frames from " << camera_path_file << std::endl;
+}
+
+/*
+ * Place the camera at the current frame of the replayed path, the camera keys have no effect meanwhile
+ * Velocity and yaw rate are replayed too so that the prefetch makes the same decisions
+ */
+void replayCameraPath()
+{
+	CameraPathFrame const& frame = camera_path[replay_frame];
+	camera_position = frame.position;
+	camera_forward = frame.forward;
+	camera_velocity = frame.velocity;
+	camera_yaw_rate = frame.yaw_rate;
+}
+
+/*
+ * Decide after the sections were managed whether this frame counts as the replayed frame
+ * While waiting, the frame is rendered again at the same camera state until its sections are loaded
+ */
+void checkReplayFrame()
+{
+	replay_frame_counted = !replay_wait_for_sections || sectionsLoaded();
+	if (!replay_frame_counted)
+		replay_wait_frames++;
+}
+
+/*
+ * Keep the stage timings of the previous frame if it counted and move on to the next frame of the path
+ */
+void advanceCameraReplay()
+{
+	if (camera_path_mode != CameraPathMode::Replay || !replay_frame_counted)
+		return;
+	ReplayFrameTiming timing;
+	for (int i = 0; i < static_cast<int>(FrameStage::Count); i++)
+		timing.stages[i] = stage_times[i].frames == 0 ? 0 : stage_times[i].window[(stage_times[i].frames - 1) % timing_window];
+	replay_timings.push_back(timing);
+	replay_frame_counted = false;
+
+	if (++replay_frame < camera_path.size())
+		return;
+	camera_path_mode = CameraPathMode::Off;
+	writeReplayTiming();
+	if (exit_after_replay)
+		exit(0);
+}
+
+
+//============================
+//		FRAME TIMING
+//============================
+
+/*
+ * Add the duration of a stage in a frame to its window and to its whole run totals
+ */
+void recordStageTime(FrameStage stage, float milliseconds)
+{
+	StageTimes& times = stage_times[static_cast<int>(stage)];
+	times.window[times.frames % timing_window] = milliseconds;
+	times.frames++;
+	times.total += milliseconds;
+	times.max = glm::max(times.max, milliseconds);
+	int bin = milliseconds <= stage_histogram_min ? 0 : static_cast<int>(glm::ceil(glm::log2(milliseconds / stage_histogram_min) * 16));
+	times.histogram[glm::min(bin, stage_histogram_bins - 1)]++;
+}
+
+/*
+ * Measure the duration of a stage from construction to destruction
+ */
+struct ScopedStageTimer
+{
+	FrameStage stage;
+	std::chrono::high_resolution_clock::time_point start;
+
+	ScopedStageTimer(FrameStage stage) : stage(stage), start(std::chrono::high_resolution_clock::now()) {}
+	~ScopedStageTimer()
+	{
+		std::chrono::duration<float, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+		recordStageTime(stage, elapsed.count());
+		if (tracing_enabled.load(std::memory_order_relaxed))
+		{
+			long long duration = static_cast<long long>(elapsed.count() * 1000);
+			traceComplete(frame_stage_names[static_cast<int>(stage)], traceTimestamp() - duration, duration);
+		}
+	}
+};
+
+/*
+ * Percentile of a stage in milliseconds over the last window frames, at most timing_window
+ * Window 0 takes the whole run from the histogram, returning the upper bound of the percentile's bin (within 4.4%) and the exact maximum
+ */
+float stagePercentile(FrameStage stage, float percentile, std::size_t window = 0)
+{
+	StageTimes const& times = stage_times[static_cast<int>(stage)];
+	if (times.frames == 0)
+		return 0;
+	if (window == 0)
+	{
+		if (percentile >= 1.f)
+			return times.max;
+		std::size_t rank = static_cast<std::size_t>(percentile * times.frames), seen = 0;
+		for (int bin = 0; bin < stage_histogram_bins; bin++)
+		{
+			seen += times.histogram[bin];
+			if (seen > rank)
+				return glm::min(stage_histogram_min * glm::exp2(bin / 16.f), times.max);
+		}
+		return times.max;
+	}
+
+	std::size_t count = glm::min(glm::min(window, timing_window), times.frames);
+	std::vector<float> samples(count);
+	for (std::size_t i = 0; i < count; i++)
+		samples[i] = times.window[(times.frames - 1 - i) % timing_window];
+	std::size_t rank = glm::min(static_cast<std::size_t>(percentile * count), count - 1);
+	std::nth_element(samples.begin(), samples.begin() + rank, samples.end());
+	return samples[rank];
+}
+
+/*
+ * Draw the rolling percentiles of every stage above the FPS line
+ */
+void drawTimingOverlay()
+{
+	if (!show_timing_overlay)
+		return;
+	int width = glutGet(GLUT_WINDOW_WIDTH),
+		height = glutGet(GLUT_WINDOW_HEIGHT);
+
+	glMatrixMode(GL_PROJECTION);
+	glPushMatrix();
+	glLoadIdentity();
+	gluOrtho2D(0, width, 0, height);
+
+	glMatrixMode(GL_MODELVIEW);
+	glPushMatrix();
+	glLoadIdentity();
+
+	char line[160];
+
+	/*Loader totals and the latest load above the stage timings*/
+	SectionStatistics total, latest;
+	int loads;
+	{
+		std::lock_guard<std::mutex> lock(section_statistics_mutex);
+		loads = static_cast<int>(section_statistics.size());
+		for (SectionStatistics const& statistics : section_statistics)
+			accumulateStatistics(total, statistics);
+		if (loads > 0)
+			latest = section_statistics.back();
+	}
+	const char* loader_labels[] = { "loads total", "latest load" };
+	SectionStatistics const* loader_lines[] = { &total, &latest };
+	for (int i = 0; i < 2 && loads > 0; i++)
+	{
+		SectionStatistics const& statistics = *loader_lines[i];
+		snprintf(line, sizeof(line), "%-12s read %10zu  accepted %10zu (%5.1f%%)  out %10zu  class 7 %8zu  %8.1f MB  wall %7.2f s  cpu %7.2f s", loader_labels[i],
+			statistics.points_read, statistics.points_accepted, statistics.points_read > 0 ? 100.0 * statistics.points_accepted / statistics.points_read : 0.0,
+			statistics.rejected_bounds, statistics.rejected_class, statistics.bytes_read / (1 << 20), statistics.wall_seconds, statistics.cpu_seconds);
+		glRasterPos2i(10, 24 + 12 * (static_cast<int>(FrameStage::Count) + 1 - i));
+		for (char* c = line; *c != '\0'; c++)
+			glutBitmapCharacter(GLUT_BITMAP_HELVETICA_10, *c);
+	}
+
+	for (int i = 0; i < static_cast<int>(FrameStage::Count); i++)
+	{
+		FrameStage stage = static_cast<FrameStage>(i);
+		snprintf(line, sizeof(line), "%-20s p50 %7.2f  p95 %7.2f  p99 %7.2f  max %7.2f ms", frame_stage_names[i],
+			stagePercentile(stage, .5f, timing_window), stagePercentile(stage, .95f, timing_window),
+			stagePercentile(stage, .99f, timing_window), stagePercentile(stage, 1.f, timing_window));
+		glRasterPos2i(10, 24 + 12 * (static_cast<int>(FrameStage::Count) - 1 - i));
+		for (char* c = line; *c != '\0'; c++)
+			glutBitmapCharacter(GLUT_BITMAP_HELVETICA_10, *c);
+	}
+
+	glPopMatrix();
+
+	glMatrixMode(GL_PROJECTION);
+	glPopMatrix();
+	glMatrixMode(GL_MODELVIEW);
+}
+
+/*
+ * Write the mean and the percentiles of every stage over the whole run to <timing_report_file>.csv and .json
+ */
+void writeTimingReport()
+{
+	if (timing_report_file.empty() || stage_times[static_cast<int>(FrameStage::Frame)].frames == 0)
+		return;
+	const float percentiles[] = { .5f, .95f, .99f, 1.f };
+
+	std::ofstream csv(timing_report_file + ".csv");
+	csv << "stage,frames,mean_ms,p50_ms,p95_ms,p99_ms,max_ms" << std::endl;
+	for (int i = 0; i < static_cast<int>(FrameStage::Count); i++)
+	{
+		csv << frame_stage_names[i] << "," << stage_times[i].frames << "," << stage_times[i].total / glm::max<std::size_t>(stage_times[i].frames, 1);
+		for (float percentile : percentiles)
+			csv << "," << stagePercentile(static_cast<FrameStage>(i), percentile);
+		csv << std::endl;
+	}
+
+	std::ofstream json(timing_report_file + ".json");
+	json << "{" << std::endl;
+	for (int i = 0; i < static_cast<int>(FrameStage::Count); i++)
+	{
+		FrameStage stage = static_cast<FrameStage>(i);
+		json << "  \"" << frame_stage_names[i] << "\": { \"frames\": " << stage_times[i].frames
+			<< ", \"mean_ms\": " << stage_times[i].total / glm::max<std::size_t>(stage_times[i].frames, 1) << ", \"p50_ms\": " << stagePercentile(stage, .5f) << ", \"p95_ms\": " << stagePercentile(stage, .95f)
+			<< ", \"p99_ms\": " << stagePercentile(stage, .99f) << ", \"max_ms\": " << stagePercentile(stage, 1.f) << " }"
+			<< (i + 1 < static_cast<int>(FrameStage::Count) ? "," : "") << std::endl;
+	}
+	json << "}" << std::endl;
+}
+
+/*
+ * Write the telemetry of every section load to loader_statistics_file, one load per line
+ */
+void writeLoaderStatistics()
+{
+	if (loader_statistics_file.empty())
+		return;
+	std::ofstream csv(loader_statistics_file);
+	csv << "origin_x,origin_y,scale,points_read,points_accepted,rejected_bounds,rejected_class,bytes_read,wall_s,cpu_s,cancelled" << std::endl;
+	std::lock_guard<std::mutex> lock(section_statistics_mutex);
+	for (SectionStatistics const& statistics : section_statistics)
+		csv << statistics.origin.x << "," << statistics.origin.y << "," << statistics.scale << "," << statistics.points_read << "," << statistics.points_accepted << ","
+			<< statistics.rejected_bounds << "," << statistics.rejected_class << "," << static_cast<long long>(statistics.bytes_read) << ","
+			<< statistics.wall_seconds << "," << statistics.cpu_seconds << "," << statistics.cancelled << std::endl;
+}
+
+/*
+ * Print the traversal totals and histograms of the last frame rendered with a heatmap
+ */
+void printTraversalStatistics()
+{
+	CudaSpace::TraversalStatistics const& stats = traversal_statistics;
+	if (stats.rays == 0)
+	{
+		std::cout << "No traversal statistics, cycle the heatmap with 'h' first" << std::endl;
+		return;
+	}
+	std::cout << "Rays " << stats.rays << ", hits " << stats.hits << std::endl;
+	std::cout << "Iterations " << stats.iterations << " (" << static_cast<double>(stats.iterations) / stats.rays << " per ray, max " << stats.max_iterations << ")" << std::endl;
+	std::cout << "LOD descents " << stats.descents << " (" << static_cast<double>(stats.descents) / stats.rays << " per ray)" << std::endl;
+	std::cout << "LOD ascents " << stats.ascents << " (" << static_cast<double>(stats.ascents) / stats.rays << " per ray)" << std::endl;
+
+	std::cout << "Iterations histogram:" << std::endl;
+	for (int i = 0; i < CudaSpace::iteration_histogram_bins; i++)
+		if (stats.iteration_histogram[i] != 0)
+			std::cout << "  " << i * CudaSpace::iteration_histogram_width << (i + 1 < CudaSpace::iteration_histogram_bins ? "-" + std::to_string((i + 1) * CudaSpace::iteration_histogram_width - 1) : "+")
+				<< ": " << stats.iteration_histogram[i] << std::endl;
+	std::cout << "Final LOD histogram:" << std::endl;
+	for (int i = 0; i < CudaSpace::max_LOD_levels; i++)
+		if (stats.final_LOD_histogram[i] != 0)
+			std::cout << "  LOD " << i << ": " << stats.final_LOD_histogram[i] << std::endl;
+	std::cout << "Grid histogram:" << std::endl;
+	for (int i = 0; i < CudaSpace::max_grids; i++)
+		if (stats.grid_histogram[i] != 0)
+			std::cout << "  " << (i < section_ring_count ? "ring " + std::to_string(i) : std::string("overview")) << ": " << stats.grid_histogram[i] << std::endl;
+}
+
+
+//============================
+//		GLUT FUNCTIONS
+//============================
+/*Displays FPS from http://stackoverflow.com/questions/20866508/using-glut-to-simply-print-text*/
+void drawFPS()
+{
+	int width = glutGet(GLUT_WINDOW_WIDTH),
+		height = glutGet(GLUT_WINDOW_HEIGHT);
+
+	glMatrixMode(GL_PROJECTION);
+	glPushMatrix();
+	glLoadIdentity();
+	gluOrtho2D(0, width, 0, height);
+
+	glMatrixMode(GL_MODELVIEW);
+	glPushMatrix();
+	glLoadIdentity();
+	glRasterPos2i(10, 10);
+
+	current_frame = sys_clock.now();
+	delta_time = current_frame - last_frame;
+	last_frame = current_frame;
+	std::string text = "FPS " + std::to_string(1 / delta_time.count()) + "| Camera Position: " + std::to_string(camera_position.x) + " " + std::to_string(camera_position.y) + " " + std::to_string(camera_position.z);
+	
+	for (int i = 0; i < text.length(); ++i) {
+		glutBitmapCharacter(GLUT_BITMAP_TIMES_ROMAN_10, text[i]);
+	}
+
+	glPopMatrix();
+
+	glMatrixMode(GL_PROJECTION);
+	glPopMatrix();
+	glMatrixMode(GL_MODELVIEW);
+}
+
+/* process menu option 'op' */
+void menu(int op)
+{
+	switch (op)
+	{
+	case 'Q':
+	case 'q':
+		exit(0);
+	default:;
+	}
+}
+
+/* executed when a regular key is pressed */
+void keyboardDown(unsigned char key, int x, int y)
+{
+	switch (key)
+	{
+	case 'p':
+	case '27':
+		exit(0);
+	case '+':
+		max_height += 100;
+		break;
+	case'-':
+		max_height -= 100;
+		break;
+
+	/* Movement */
+	case 'e':
+		movement_up = qe_movement_distance;
+		break;
+	case 'q':
+		movement_up = -qe_movement_distance;
+		break;
+	case'a':
+		movement_rht = wasd_movement_distance;
+		break;
+	case'd':
+		movement_rht = -wasd_movement_distance;
+		break;
+	case 'w':
+		movement_fwd = wasd_movement_distance;
+		break;
+	case 's':
+		movement_fwd = -wasd_movement_distance;
+		break;
+
+	/* Rotation */
+	case 'i':
+		rotation_right = ik_rotation_angle;
+		break;
+	case 'k':
+		rotation_right = -ik_rotation_angle;
+		break;
+	case 'j':
+		rotation_up = -jl_rotation_angle;
+		break;
+	case 'l':
+		rotation_up = jl_rotation_angle;
+		break;
+
+	/* Visualization parameters */
+	case 'r':
+		if (section_rings[0].h_color_map != NULL)
+			use_color_map = !use_color_map;
+		break;
+	case 't':
+		use_LOD = !use_LOD;
+		break;
+	case 'm':
+		printMemoryUsage();
+		break;
+	case 'o':
+		show_timing_overlay = !show_timing_overlay;
+		break;
+	case 'x':
+		toggleTracing();
+		break;
+	case 'c':
+		toggleCameraRecording();
+		break;
+	case 'v':
+		toggleCameraReplay();
+		break;
+	case 'h':
+		heatmap_mode = static_cast<CudaSpace::HeatmapMode>((static_cast<int>(heatmap_mode) + 1) % static_cast<int>(CudaSpace::HeatmapMode::Count));
+		std::cout << "Heatmap: " << heatmap_mode_names[static_cast<int>(heatmap_mode)] << std::endl;
+		break;
+	case 'n':
+		printTraversalStatistics();
+		break;
+	default:;
+	}
+}
+
+void keyboardUp(unsigned char key, int x, int y)
+{
+	switch (key)
+	{
+	case 'p':
+	case 27:
+		glutLeaveFullScreen();
+		glutLeaveMainLoop();
+	case 'e':
+	case 'q':
+		movement_up = 0;
+		break;
+	case 'a':
+	case 'd':
+		movement_rht = 0;
+		break;
+	case 'w':
+	case 's':
+		movement_fwd = 0;
+		break;
+	case 'i':
+	case 'k':
+		rotation_right = 0;
+		break;
+	case 'j':
+	case 'l':
+		rotation_up = 0;
+	default:;
+	}
+}
+
+/* reshaped window */
+void reshape(int width, int height)
+{
+	GLfloat fieldOfView = 90.0f;
+	glViewport(0, 0, static_cast<GLsizei>(width), static_cast<GLsizei>(height));
+
+	glMatrixMode(GL_PROJECTION);
+	glLoadIdentity();
+	gluPerspective(fieldOfView, static_cast<GLfloat>(width) / static_cast<GLfloat>(height), 0.1, 500.0);
+
+	glMatrixMode(GL_MODELVIEW);
+	glLoadIdentity();
+}
+
+/* executed when button 'button' is put into state 'state' at screen position ('x', 'y') */
+void mouseClick(int button, int state, int x, int y)
+{
+}
+
+/* executed when the mouse moves to position ('x', 'y') */
+void mouseMotion(int x, int y)
+{
+}
+
+/* render the scene */
+void draw()
+{
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	glMatrixMode(GL_MODELVIEW);
+	glLoadIdentity();
+
+	advanceCameraReplay();
+	ScopedStageTimer frame_timer(FrameStage::Frame);
+	if (camera_path_mode == CameraPathMode::Replay)
+		replayCameraPath();
+	else
+	{
+		moveCamera();
+		rotateCamera();
+		recordCameraPathFrame();
+	}
+	{
+		ScopedStageTimer timer(FrameStage::ManageSections);
+		manageSections();
+	}
+	if (camera_path_mode == CameraPathMode::Replay)
+		checkReplayFrame();
+
+	/* render the scene here */
+	{
+		ScopedStageTimer timer(FrameStage::PreparePointBuffer);
+		preparePointBuffer();
+	}
+	{
+		ScopedStageTimer timer(FrameStage::CopyPointBuffer);
+		copyPointBuffer();
+	}
+	{
+		ScopedStageTimer timer(FrameStage::UpdateTexture);
+		updateTexture();
+	}
+	{
+		ScopedStageTimer timer(FrameStage::RenderTexture);
+		renderTexture();
+	}
+	drawFPS();
+	drawTimingOverlay();
+
+	glFlush();
+	glutSwapBuffers();
+}
+
+/* executed when program is idle */
+void idle()
+{
+	draw();
+}
+
+/* initialize OpenGL settings */
+void initGL(int width, int height)
+{
+	reshape(width, height);
+
+	glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+	glClearDepth(1.0f);
+
+	glEnable(GL_DEPTH_TEST);
+	glDepthFunc(GL_LEQUAL);
+}
+
+
+//============================
+//        RESOURCES
+//============================
+/* Allocate resources */
+/*
+ * Lay out the levels of a section's Quad-trees, coarsest level first
+ */
+void initializeLODLayout()
+{
+	LOD_resolutions[LOD_levels - 1] = point_buffer_resolution.x;
+	LOD_indexes[LOD_levels - 1] = 0;
+	stride_x = static_cast<int>(glm::pow(4.f, LOD_levels - 1));
+	for (auto i = LOD_levels - 2; i >= 0; i--)
+	{
+		LOD_indexes[i] = LOD_indexes[i + 1] + LOD_resolutions[i + 1] * LOD_resolutions[i + 1];
+		LOD_resolutions[i] = LOD_resolutions[i + 1] * 2;
+		stride_x += static_cast<int>(glm::pow(4.f, i));
+	}
+}
+
+void initialize()
+{
+	glewInit();
+	initializeLODLayout();
+
+	readLASHeader(point_cloud_file);
+	section_ring_count = glm::clamp(section_ring_count, 1, max_section_rings);
+	for (int i = 0; i < section_ring_count; i++)
+	{
+		section_rings[i].scale = glm::pow(2.f, i);
+		initializeSections(section_rings[i]);
+	}
+
+	checkCudaErrors(cudaGLSetGLDevice(gpuGetMaxGflopsDeviceId()));
+	setupTexture();
+	CudaSpace::initializeDeviceVariables(texture_resolution);
+
+	/*The point buffers of the rings are the first grids from finest to coarsest, the overview catches the rays leaving them*/
+	for (grid_count = 0; grid_count < section_ring_count; grid_count++)
+	{
+		SectionRing& ring = section_rings[grid_count];
+		ring.h_point_buffer = new float[point_buffer_resolution.x * point_buffer_resolution.y * stride_x];
+		ring.h_color_map = new CudaSpace::PackedColor[point_buffer_resolution.x * point_buffer_resolution.y * stride_x];
+		trackMemory(MemoryClass::PointBuffer, sizeof(float) * point_buffer_resolution.x * point_buffer_resolution.y * stride_x);
+		trackMemory(MemoryClass::ColorMap, sizeof(CudaSpace::PackedColor) * point_buffer_resolution.x * point_buffer_resolution.y * stride_x);
+		checkCudaErrors(cudaMalloc(&ring.d_point_buffer, sizeof(float) * point_buffer_resolution.x * point_buffer_resolution.y * stride_x));
+		checkCudaErrors(cudaMalloc(&ring.d_color_map, sizeof(CudaSpace::PackedColor) * point_buffer_resolution.x * point_buffer_resolution.y * stride_x));
+		setupGridPyramid(grids[grid_count], LOD_resolutions[0], LOD_levels, ring.scale);
+		grids[grid_count].heights = ring.d_point_buffer;
+		grids[grid_count].colors = ring.d_color_map;
+	}
+	if (use_overview)
+	{
+		initializeOverview();
+		grids[grid_count++] = overview_grid;
+	}
+
+}
+
+/* Free Resources */
+void freeResourcers()
+{
+	writeTimingReport();
+	if (tracing_enabled)
+		toggleTracing();
+	if (camera_path_mode == CameraPathMode::Record)
+		toggleCameraRecording();
+	checkCudaErrors(cudaDeviceSynchronize());
+	CudaSpace::freeDeviceVariables();
+	if (use_overview)
+	{
+		overview_exit = true;
+		overview_thread->join();
+		delete overview_thread;
+		checkCudaErrors(cudaFree(overview_grid.heights));
+		checkCudaErrors(cudaFree(overview_grid.colors));
+		delete[](h_overview_heights);
+		delete[](h_overview_colors);
+	}
+	/*Free the unloaded sections directly instead of caching and compressing them for nothing*/
+	section_cache_budget = 0;
+	for (int i = 0; i < section_ring_count; i++)
+	{
+		SectionRing& ring = section_rings[i];
+		checkCudaErrors(cudaFree(ring.d_point_buffer));
+		checkCudaErrors(cudaFree(ring.d_color_map));
+		delete[](ring.h_color_map);
+		delete[](ring.h_point_buffer);
+		for (int column = 0; column < point_sections_size; column++)
+			unloadSectionsColumn(ring, column);
+	}
+	for each(PrefetchedSection const& section in section_prefetches)
+		releaseSection(MemoryClass::Prefetch, section.ring, section.tile, section.thread, section.state, section.valid_LOD, section.point_section, section.color_section);
+	section_prefetches.clear();
+	while (!section_cache.empty())
+		evictCachedSection();
+	stopSectionCompressor();
+	writeLoaderStatistics();
+}
@@ -0,0 +1,395 @@
+#pragma once
+
+/*
+ * Globals, types and functions of the raytracer, defined in HeightmapRaytracer.cpp
+ * Shared by the viewer in main.cpp and by the benchmark
+ */
+#define GLM_FORCE_CUDA
+
+#include <iostream>
+#include <fstream>
+#include <thread>
+#include <string>
+#include <chrono>
+#include <vector>
+#include <list>
+#include <atomic>
+#include <algorithm>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <cstdio>
+#include <iomanip>
+#include <memory>
+#include <unordered_map>
+
+#include <GL/glew.h>
+#include <GL/freeglut.h>
+#include <glm/glm.hpp>
+#include <glm/gtx/rotate_vector.hpp>
+
+#include <liblas/liblas.hpp>
+#include <liblas/chipper.hpp>
+
+#include <cuda_gl_interop.h>
+#include <cuda_runtime.h>
+
+#include "CudaKernel.cuh"
+#include "helper_cuda.h"
+
+#include <Windows.h>
+
+
+//============================
+//		GLOBAL VARIABLES
+//============================
+
+// Filenames
+extern std::string point_cloud_file; // A LAS/LAZ file or a directory of tiles in the data folder
+extern std::string color_map_file;
+
+// Camera related
+extern glm::ivec2 texture_resolution;
+extern glm::vec3
+	camera_position,
+	camera_forward,
+	frame_dimension; //width, height, distance from camera
+extern glm::vec2 boundaries;
+
+extern GLuint textureID;
+extern GLuint bufferID;
+extern bool use_LOD;
+extern bool use_color_map;
+extern CudaSpace::HeatmapMode heatmap_mode; // Cycled with 'h', shows the traversal cost instead of the color
+extern const char* heatmap_mode_names[];
+extern CudaSpace::TraversalStatistics traversal_statistics; // Of the last frame rendered with a heatmap
+
+// JPEG image
+extern glm::ivec2 color_map_resolution;
+
+// Point buffer to be copied to GPU
+extern glm::ivec2 point_buffer_resolution;
+
+// CPU-Side point sections
+const int point_sections_size = 4;
+
+// Loading state of a section shared with its loader thread, whoever leaves Loading first decides who frees the section
+enum class SectionState { Loading, Complete, Cancelled };
+
+/*
+ * Sections around the camera and the point buffer assembled from them
+ * The cells of a ring are scale finest cells wide, its origins are given in its own cells
+ */
+struct SectionRing
+{
+	float scale;
+	std::thread* thread_pool[point_sections_size][point_sections_size];
+	std::atomic<SectionState> * section_state[point_sections_size][point_sections_size];
+	std::atomic<int> * section_valid_LOD[point_sections_size][point_sections_size]; // Finest LOD of a section that is completely loaded, stored with release by its loader once the data below it is written
+	float* point_sections[point_sections_size][point_sections_size];
+	CudaSpace::PackedColor* color_sections[point_sections_size][point_sections_size];
+	glm::vec2 point_sections_origins[point_sections_size][point_sections_size];
+	bool covered[point_sections_size][point_sections_size]; // The inner ring holds the section, it is read from there and never loaded
+	float* h_point_buffer;
+	CudaSpace::PackedColor* h_color_map;
+	float* d_point_buffer;
+	CudaSpace::PackedColor* d_color_map;
+};
+
+// Clipmap rings, ring k is twice as coarse as ring k - 1 and covers twice its extent
+// Sections of an outer ring inside the inner ring's footprint are not loaded, the others cost as much as in the first ring
+const int max_section_rings = 4;
+extern int section_ring_count;
+extern SectionRing section_rings[max_section_rings];
+
+// Fully loaded sections evicted from a ring, most recently evicted first
+// A cached section is either raw or, once the compressor has packed it, only kept packed
+struct CachedSection
+{
+	int ring;
+	glm::ivec2 tile; // Origin of the section in section extents of its ring
+	float* point_section = nullptr;
+	CudaSpace::PackedColor* color_section = nullptr;
+	std::vector<unsigned int> packed; // Packed quantized heights followed by packed colors
+	float height_step = 1; // Height of a quantization step
+	long long bytes = 0; // Bytes accounted to the cache
+};
+extern std::list<CachedSection> section_cache;
+extern std::size_t section_cache_budget; // Bytes of evicted sections kept, 0 disables the cache
+extern bool compress_cached_sections;
+
+// Single worker packing the cached sections in the order they were cached, the queue and the hand-over are guarded by the mutex
+extern std::thread* section_compressor;
+extern std::mutex section_compressor_mutex;
+extern std::condition_variable section_compressor_wake, section_compressor_idle;
+extern std::deque<CachedSection*> section_compress_queue;
+extern CachedSection* section_compressing; // Section being packed, reset when it leaves the cache so that the worker only frees its raw buffers
+extern bool section_compressor_exit;
+const int pack_block_size = 128; // Values sharing a bit width in packed sections
+const float height_quantization_steps = 1 << 20; // Steps between zero and the highest point of a compressed section
+
+// Sections loaded ahead of the camera, adopted by their ring once they enter it
+struct PrefetchedSection
+{
+	int ring;
+	glm::ivec2 tile;
+	std::thread* thread;
+	std::atomic<SectionState>* state;
+	std::atomic<int>* valid_LOD;
+	float* point_section;
+	CudaSpace::PackedColor* color_section;
+};
+extern std::list<PrefetchedSection> section_prefetches;
+extern float prefetch_horizon; // Seconds of extrapolated flight whose sections are loaded ahead, 0 disables the prefetch
+const int prefetch_max_sections = 8; // Prefetch loaders running at the same time, complete prefetches are only bounded by the memory budget
+
+// Host memory accounting by allocation class
+// Cancelled holds the sections of cancelled loads until their loaders free them, it is reported but left out of the budget
+enum class MemoryClass { Sections, Prefetch, Cache, Loaders, Cancelled, PointBuffer, ColorMap, Overview, Count };
+extern const char* memory_class_names[];
+extern std::atomic<long long> memory_usage[static_cast<int>(MemoryClass::Count)];
+extern std::size_t memory_budget; // Host bytes for every class, 0 disables the governor
+extern bool memory_over_budget; // Set while the resident rings alone exceed the budget
+
+// Trace recording, every thread appends to its own list of event blocks
+struct TraceEvent
+{
+	const char* name; // String literal
+	char phase; // 'X' complete, 'i' instant
+	long long timestamp, duration; // Microseconds since trace_epoch
+	const char* arg_names[2]; // Null for unused args
+	long long args[2];
+};
+const std::size_t trace_block_events = 1024;
+struct TraceBlock
+{
+	TraceEvent events[trace_block_events];
+	std::atomic<std::size_t> count{ 0 }; // Events published by the owning thread
+	std::atomic<TraceBlock*> next{ nullptr };
+};
+struct ThreadTrace
+{
+	int id;
+	const char* name;
+	TraceBlock first;
+	TraceBlock* last; // Only used by the owning thread
+	std::atomic<bool> exited{ false }; // Set when the owning thread ends, the buffer is freed once its events have been written
+};
+// Marks the calling thread's buffer as exited when the thread ends
+struct TraceThreadExit
+{
+	~TraceThreadExit();
+};
+extern std::atomic<bool> tracing_enabled;
+extern std::string trace_file;
+extern long long trace_session_start; // Events before the last start of the recording are not written
+extern std::vector<ThreadTrace*> trace_threads; // Buffers of exited threads are kept until the next written trace so that events outlive their threads
+extern int trace_thread_count; // Trace ids handed out so far, ids are not reused after a buffer is freed
+extern std::mutex trace_threads_mutex; // Only taken when a thread records its first event and when writing
+
+// Spatially coherent block of points of a file, built with the liblas chipper
+struct ChipBlock
+{
+	glm::dvec2 min, max;
+	std::vector<unsigned int> ids; // Sorted point ids
+};
+
+// Dataset catalog, the header of every LAS/LAZ file of the dataset
+struct CatalogFile
+{
+	std::string filename; // Relative to the data folder
+	unsigned long long file_size = 0, modified = 0; // Stamp of the file when its header was read
+	glm::dvec3 min, max;
+	unsigned int point_count;
+	bool compressed;
+	int point_format;
+	double point_bytes; // Average bytes of a point record on disk
+	bool chipped = false; // Set once the chipper blocks are loaded
+	std::shared_ptr<std::mutex> chips_mutex = std::make_shared<std::mutex>(); // Held by the loader loading or building the blocks of this file
+	std::vector<ChipBlock> chips;
+};
+extern std::vector<CatalogFile> catalog;
+extern glm::dvec3 dataset_min, dataset_max; // Bounds of every file of the catalog
+const std::string catalog_index_file = "catalog.txt"; // Index kept in a directory dataset
+
+// Indexed reads, sections only read the chipper blocks they overlap
+extern bool use_chipper;
+const unsigned int chip_block_size = 16384; // Maximum points per chipper block
+const std::string chips_file_extension = ".chips"; // Block cache written next to every file
+const std::size_t max_read_through = 8; // Longest gap of points read through instead of seeking
+
+// Parallel decoding of compressed files, every loader decodes a LAZ file with several workers
+extern int laz_decode_workers; // Decoding workers per loader, 1 decodes on the loader thread
+const std::size_t laz_chunk_points = 50000; // Points per range, the default LASzip chunk size so that ranges start on chunks
+const std::size_t decode_batch_points = 4096; // Points handed over to the loader at once
+const std::size_t max_decode_batches = 64; // Batches queued per loader before the workers wait
+
+extern glm::vec3 cell_size; //Cell size at the finest LOD level
+extern float cell_size_override; // Manual cell size, 0 derives it from the point density
+extern float points_per_cell; // Average number of points targeted per finest cell
+const int density_sample_points = 4096; // Points sampled to estimate the occupied area of the cloud
+extern bool progressive_loading; // Load a strided subsample first so new sections show up coarse instead of as holes
+const int progressive_stride = 64; // One point out of progressive_stride is loaded in the coarse pass
+const int density_histogram_size = 16; // Bins per axis of the sampled density histogram, a few samples per bin on uniform clouds
+extern float max_height;
+extern float height_tolerance;
+const int LOD_levels = 8;
+extern int stride_x; // Number of elements per Quad-tree root
+extern int LOD_resolutions[LOD_levels];
+extern int LOD_indexes[LOD_levels];
+
+// Height aggregation of the points falling in the same finest cell
+enum class HeightAggregation { Max, Min, Mean, Percentile };
+extern HeightAggregation height_aggregation;
+const float height_percentile = 0.95f;
+const int percentile_max_cell_points = 64; // Points of a cell up to which the percentile is exact, denser cells reject more of their highest points
+const int percentile_max_tracked_values = 8; // Bound of the heights kept per cell for low percentiles
+// Highest heights kept per cell, one more than the points above the percentile in a cell of percentile_max_cell_points points
+const int percentile_tracked_values = glm::clamp(static_cast<int>(glm::ceil((1.f - height_percentile) * percentile_max_cell_points - 1e-3f)) + 1, 2, percentile_max_tracked_values);
+
+// Color aggregation of the points falling in the same finest cell
+enum class ColorAggregation { Average, HighestPoint };
+extern ColorAggregation color_aggregation;
+const unsigned int color_count_limit = 1023; // Points an Average color accumulator counts before its cell moves to exact sums
+
+// Whole dataset overview traversed by the rays leaving the point buffer
+extern bool use_overview;
+const int overview_max_resolution = 1024; // Finest resolution of the overview
+const int overview_LOD_levels = 6;
+const std::string summary_file_extension = ".overview"; // Highest points of a file on a coarse grid, written next to it
+extern CudaSpace::GridPyramid overview_grid; // Host copy of the overview layout, the pointers are the device buffers
+extern int overview_size; // Number of elements of the overview pyramid
+extern float* h_overview_heights;
+extern CudaSpace::PackedColor* h_overview_colors;
+extern std::thread* overview_thread;
+extern std::atomic<bool> overview_exit; // Set by the main thread to stop the overview thread
+extern std::atomic<bool> overview_complete; // Set by the overview thread once the host overview is written, the upload reads it before the buffers
+extern std::atomic<bool> overview_uploaded; // Set once the complete overview has been sent, sectionsLoaded() reads it
+
+// Grids traversed by the rays, the point buffer first
+extern CudaSpace::GridPyramid grids[CudaSpace::max_grids];
+extern int grid_count;
+
+// clock
+extern std::chrono::system_clock sys_clock;
+extern std::chrono::time_point<std::chrono::system_clock> last_frame, current_frame;
+extern std::chrono::duration<float> delta_time;
+
+// movement
+extern glm::vec2 camera_velocity; // Smoothed horizontal velocity, extrapolated by the prefetch
+extern float camera_yaw_rate;
+extern float movement_rht;
+extern float movement_fwd;
+extern float movement_up;
+extern float right_movement;
+extern float wasd_movement_distance;
+extern float qe_movement_distance;
+extern float fixed_time_step; // Seconds per frame of the camera movement when above 0, set with --fixed-step
+
+// rotation
+extern float rotation_up;
+extern float rotation_right;
+extern float ik_rotation_angle;
+extern float jl_rotation_angle;
+
+// frame timing, the duration of every stage of draw() in milliseconds, the latest frames for the overlay and whole run totals for the report
+enum class FrameStage { ManageSections, PreparePointBuffer, CopyPointBuffer, UpdateTexture, RenderTexture, Frame, Count };
+extern const char* frame_stage_names[];
+const std::size_t timing_window = 512; // Frames of the rolling percentiles shown on screen
+const int stage_histogram_bins = 448; // Bins of the whole run histograms, 16 per doubling from stage_histogram_min up to about 250 s
+const float stage_histogram_min = .001f; // Upper bound of the first bin in milliseconds
+struct StageTimes
+{
+	float window[timing_window]; // Ring buffer of the latest frames, frames % timing_window is written next
+	std::size_t frames = 0;
+	double total = 0; // Milliseconds over the whole run
+	float max = 0;
+	unsigned int histogram[stage_histogram_bins] = {}; // Frames of the whole run per bin
+};
+extern StageTimes stage_times[static_cast<int>(FrameStage::Count)];
+extern bool show_timing_overlay;
+extern std::string timing_report_file; // Written as .csv and .json on exit, empty disables the report
+
+// Loader telemetry, the point counts and costs of every section load
+struct SectionStatistics
+{
+	glm::vec2 origin;
+	float scale = 1;
+	std::size_t points_read = 0, points_accepted = 0, rejected_bounds = 0, rejected_class = 0; // Class 7 rejects are not counted as out of bounds
+	double bytes_read = 0; // Point record bytes on disk, estimated from the file's average for compressed files
+	double wall_seconds = 0, cpu_seconds = 0; // CPU time includes the decoding workers
+	bool cancelled = false;
+};
+extern std::vector<SectionStatistics> section_statistics;
+extern std::mutex section_statistics_mutex;
+extern std::string loader_statistics_file; // Written on exit, empty disables the file
+
+// Camera path recording ('c') and replay ('v'), the camera state of every frame
+enum class CameraPathMode { Off, Record, Replay };
+struct CameraPathFrame
+{
+	float time_step;
+	glm::vec3 position, forward;
+	glm::vec2 velocity; // Prefetch inputs, replayed as recorded
+	float yaw_rate;
+};
+struct ReplayFrameTiming
+{
+	float stages[static_cast<int>(FrameStage::Count)];
+};
+extern CameraPathMode camera_path_mode;
+extern std::string camera_path_file;
+extern std::vector<CameraPathFrame> camera_path;
+extern std::size_t replay_frame;
+extern bool replay_wait_for_sections; // Render a frame of the path again until its sections are loaded
+extern bool replay_frame_counted; // Set when the current frame is timed as the replayed frame
+extern int replay_wait_frames;
+extern std::vector<ReplayFrameTiming> replay_timings;
+extern std::string replay_timing_file; // Stage timings of every replayed frame, empty disables the file
+extern bool exit_after_replay;
+
+//============================
+//		CUDA VARIABLES
+//============================
+
+extern struct cudaGraphicsResource* cuda_pbo_resource;
+
+
+//============================
+//		FUNCTIONS
+//============================
+
+// Memory accounting and tracing
+std::size_t sectionBytes();
+void traceThreadName(const char* name);
+
+// LAS
+void readLASHeader(std::string filename);
+void buildMaxPyramid(float *point_section, int levels = LOD_levels, const int *indexes = LOD_indexes, const int *resolutions = LOD_resolutions);
+void buildColorPyramid(float *point_section, CudaSpace::PackedColor *color_section, int levels = LOD_levels, const int *indexes = LOD_indexes, const int *resolutions = LOD_resolutions);
+void loadLASToSection(glm::vec2 origin, float scale, std::atomic<SectionState> *state, std::atomic<int> *valid_LOD, float *point_section, CudaSpace::PackedColor * color_section);
+
+// Sections and grids
+void setupGridPyramid(CudaSpace::GridPyramid& grid, int resolution, int levels, float scale);
+void preparePointBuffer(SectionRing& ring, CudaSpace::GridPyramid& grid);
+
+// Camera path
+bool loadCameraPath();
+void toggleCameraRecording();
+void toggleCameraReplay();
+
+// GLUT
+void menu(int op);
+void keyboardDown(unsigned char key, int x, int y);
+void keyboardUp(unsigned char key, int x, int y);
+void reshape(int width, int height);
+void mouseClick(int button, int state, int x, int y);
+void mouseMotion(int x, int y);
+void draw();
+void idle();
+void initGL(int width, int height);
+
+// Resources
+void initializeLODLayout();
+void initialize();
+void freeResourcers();
@@ -0,0 +1,288 @@
+#pragma once
+
+#include "CudaKernel.cuh"
+#include <cmath>
+
+/*
+ * The ray traversal of the height pyramids, shared by the CUDA kernel and host builds such as the benchmark
+ * Everything the traversal reads is passed in TraversalParameters instead of device variables
+ */
+namespace CudaSpace
+{
+	struct TraversalParameters
+	{
+		bool use_color_map;
+		float max_height;
+		float pixel_footprint; // Width of a pixel in grid cells at unit distance from the camera
+		GridPyramid const* grids; // Traversed in order, the first one is the point buffer around the camera
+		int grid_count;
+	};
+
+	/*
+	 * Traversal work of a single ray
+	 */
+	struct TraversalCounters
+	{
+		int iterations = 0, descents = 0, ascents = 0;
+		int final_LOD = -1, grid = -1; // -1 while the ray hit nothing
+	};
+
+	/*
+	* Get a colormap value from a height map index at the given LOD
+	*/
+	__device__ __host__ inline void getColorMapValue(GridPyramid const& grid, int posX, int posZ, bool mirrorX, bool mirrorZ, int LOD, Color& result)
+	{
+		if (mirrorX)
+			posX = grid.LOD_resolutions[LOD] - 1 - posX;
+		if (mirrorZ)
+			posZ = grid.LOD_resolutions[LOD] - 1 - posZ;
+
+		result = unpackColor(grid.colors[grid.LOD_indexes[LOD] + posX + posZ * grid.LOD_resolutions[LOD]]);
+	}
+
+	/*
+	* Select the color LOD whose cells match the footprint of a pixel at the given distance in grid cells
+	*/
+	__device__ __host__ inline int getColorLOD(TraversalParameters const& parameters, GridPyramid const& grid, float distance)
+	{
+		float footprint = distance * parameters.pixel_footprint;
+		if (footprint <= 1)
+			return 0;
+		return glm::min(static_cast<int>(floor(log2(footprint))), grid.LOD_levels - 1);
+	}
+
+	/*
+	* Get a value based on max height
+	*/
+	__device__ __host__ inline void getHeightColorValue(TraversalParameters const& parameters, float height, Color& result)
+	{
+		unsigned char r, g, b;
+		height = height * 2 / parameters.max_height ;
+		if(height > 1)
+		{
+			height -= 1;
+			r = 255;
+			g = 255 - height * 255;
+			b = 0;
+		}
+		else
+		{
+			r = 255 * height;
+			g = r;
+			b = 255 - height * 255;
+		}
+		result = Color(r, g, b);
+	}
+
+	/*
+	 * Retrieve the height value from point buffer based on LOD and position
+	 */
+	__device__ __host__ inline float getPointBufferValue(GridPyramid const& grid, int posX, int posZ, bool mirrorX, bool mirrorZ, int LOD)
+	{
+		if (mirrorX)
+			posX = grid.LOD_resolutions[LOD] - 1 - posX;
+		if (mirrorZ)
+			posZ = grid.LOD_resolutions[LOD] - 1 - posZ;
+
+		return grid.heights[grid.LOD_indexes[LOD] + posX + posZ * grid.LOD_resolutions[LOD]];
+	}
+
+	/*
+	 * Finest LOD loaded by the section that holds the given position
+	 */
+	__device__ __host__ inline int getValidLOD(GridPyramid const& grid, glm::vec3& position, bool mirrorX, bool mirrorZ)
+	{
+		int posX = floor(position.x), posZ = floor(position.z);
+		if (mirrorX)
+			posX = grid.LOD_resolutions[0] - 1 - posX;
+		if (mirrorZ)
+			posZ = grid.LOD_resolutions[0] - 1 - posZ;
+
+		return grid.valid_LOD[(posX >= grid.section_split.x ? 1 : 0) + (posZ >= grid.section_split.y ? 2 : 0)];
+	}
+
+	/*
+	 *Calculate exit point based on current ray position
+	 */
+	__device__ __host__ inline void calculateExitPointAndEdge(glm::vec3& entry, glm::vec3& direction, glm::vec3& exit, int &edge, int LOD)
+	{
+		float tX, tZ;
+		tX = ((floor(entry.x / pow(2.f, LOD)) + 1) * pow(2.f, LOD) - entry.x) / direction.x;
+		tZ = ((floor(entry.z / pow(2.f, LOD)) + 1) * pow(2.f, LOD) - entry.z) / direction.z;
+		if(tX <= tZ)
+		{
+			exit = entry + tX * direction;
+			exit.x = (floor(entry.x / pow(2.f, LOD)) + 1) * pow(2.f, LOD);
+			edge = floor(exit.x / pow(2.f, LOD));
+		}
+		else
+		{
+			exit = entry + tZ * direction;
+			exit.z = (floor(entry.z / pow(2.f, LOD)) + 1) * pow(2.f, LOD);
+			edge = floor(exit.z / pow(2.f, LOD));
+		}
+	}
+
+	/*
+	 * Test if the ray intersects with the height field
+	 */
+	__device__ __host__ inline bool testIntersection(GridPyramid const& grid, glm::vec3 &entry, glm::vec3 &exit, glm::vec3 &direction, bool mirrorX, bool mirrorZ, int &LOD)
+	{
+		bool result;
+		float height;
+
+		height = getPointBufferValue(grid, floor(entry.x / pow(2.f, LOD)), floor(entry.z / pow(2.f, LOD)), mirrorX, mirrorZ, LOD);
+		if(direction.y >= 0)
+		{
+			result = entry.y <= height;
+		}
+		else
+		{
+			result = exit.y <= height;
+			if (result)
+				entry += glm::max(0.f, (height - entry.y) / direction.y) * direction;
+		}
+
+		return result;		
+	}
+
+	/*
+	 * Convert a dataset space position to the (mirrored) space of a grid and back
+	 */
+	__device__ __host__ inline glm::vec3 datasetToGridSpace(GridPyramid const& grid, glm::vec3 position, bool mirrorX, bool mirrorZ)
+	{
+		position = glm::vec3(position.x - grid.origin.x, position.y, position.z - grid.origin.y) / grid.scale;
+		if (mirrorX)
+			position.x = grid.LOD_resolutions[0] - position.x;
+		if (mirrorZ)
+			position.z = grid.LOD_resolutions[0] - position.z;
+		return position;
+	}
+
+	__device__ __host__ inline glm::vec3 gridToDatasetSpace(GridPyramid const& grid, glm::vec3 position, bool mirrorX, bool mirrorZ)
+	{
+		if (mirrorX)
+			position.x = grid.LOD_resolutions[0] - position.x;
+		if (mirrorZ)
+			position.z = grid.LOD_resolutions[0] - position.z;
+		return glm::vec3(position.x * grid.scale + grid.origin.x, position.y * grid.scale, position.z * grid.scale + grid.origin.y);
+	}
+
+	/*
+	 *	Dick, C., et al. (2009). GPU ray-casting for scalable terrain rendering. Proceedings of EUROGRAPHICS, Citeseer.
+	 *	Traverse a single grid, ray_position is given in dataset space and moved to where the ray leaves the grid
+	 *	ray_direction MUST be normalized
+	 *	Returns true if the ray hit the height field of this grid
+	 */
+	__device__ __host__ inline bool marchGrid(TraversalParameters const& parameters, GridPyramid const& grid, glm::vec3& ray_position, glm::vec3 ray_direction, glm::vec3& ray_origin, Color& result, TraversalCounters& counters)
+	{
+		bool mirrorX, mirrorZ;
+		glm::vec3 position, ray_exit;
+		int edge;
+		int LOD = grid.LOD_levels - 1;
+		int color_LOD;
+		bool intersection;
+		float t = 0;
+		float extent = static_cast<float>(grid.LOD_resolutions[0]);
+		float grid_max_height = parameters.max_height / grid.scale;
+
+		/*Mirror direction to simplify algorithm*/
+		mirrorX = ray_direction.x < 0;
+		mirrorZ = ray_direction.z < 0;
+		ray_direction.x = glm::abs(ray_direction.x);
+		ray_direction.z = glm::abs(ray_direction.z);
+		position = datasetToGridSpace(grid, ray_position, mirrorX, mirrorZ);
+
+		/*Move rays that start in front of the grid to its border*/
+		if (position.x < 0)
+			t = glm::max(t, -position.x / ray_direction.x);
+		if (position.z < 0)
+			t = glm::max(t, -position.z / ray_direction.z);
+		if (glm::isinf(t))
+			return false;
+		position += t * ray_direction;
+
+		/*Advance ray until it is outside of the grid*/
+		while(position.x < extent && position.z < extent && !(ray_direction.y > 0 && position.y > grid_max_height))
+		{
+			counters.iterations++;
+			calculateExitPointAndEdge(position, ray_direction, ray_exit, edge, LOD);
+			intersection = testIntersection(grid, position, ray_exit, ray_direction, mirrorX, mirrorZ, LOD);
+			if(intersection)
+			{
+				/*Sections still loading are only refined down to their valid LOD*/
+				if (LOD > 0 && LOD > getValidLOD(grid, position, mirrorX, mirrorZ))
+				{
+					LOD--;
+					counters.descents++;
+				}
+				else
+				{
+					counters.final_LOD = LOD;
+					if (parameters.use_color_map)
+					{
+						color_LOD = glm::max(getColorLOD(parameters, grid, glm::length(gridToDatasetSpace(grid, position, mirrorX, mirrorZ) - ray_origin) / grid.scale), LOD);
+						getColorMapValue(grid, floor(position.x / pow(2.f, color_LOD)), floor(position.z / pow(2.f, color_LOD)), mirrorX, mirrorZ, color_LOD, result);
+					}
+					else
+						getHeightColorValue(parameters, position.y * grid.scale, result);
+					return true;
+				}
+				
+			}
+			else
+			{
+				int next_LOD = glm::min(LOD + 1 - (edge % 2), grid.LOD_levels - 1);
+				if (next_LOD > LOD)
+					counters.ascents++;
+				LOD = next_LOD;
+				position = ray_exit;			
+			}
+		}
+
+		ray_position = gridToDatasetSpace(grid, position, mirrorX, mirrorZ);
+		return false;
+	}
+
+	/*
+	 *	Continue the ray through the grids, from the point buffer around the camera to the coarser ones
+	 *	ray_direction MUST be normalized
+	 */
+	__device__ __host__ inline void castRay(TraversalParameters const& parameters, glm::vec3& ray_position, glm::vec3& ray_direction, Color& result, TraversalCounters& counters)
+	{
+		glm::vec3 ray_origin = ray_position;
+		for (int i = 0; i < parameters.grid_count; i++)
+		{
+			if (marchGrid(parameters, parameters.grids[i], ray_position, ray_direction, ray_origin, result, counters))
+			{
+				counters.grid = i;
+				return;
+			}
+		}
+	}
+	
+	/*
+	 * Converts a pixel position to the grid space
+	 * Pinhole camera model - From: Realistic Ray Tracing by Peter Shirley, pages 37-42
+	 */
+	__device__ __host__ inline glm::vec3 viewToGridSpace(glm::ivec2 const& pixel_position, glm::vec3 const& frame_dimension, glm::ivec2 const& texture_resolution)
+	{
+		glm::vec3 result = glm::vec3(
+			 frame_dimension.x / 2.0f - (frame_dimension.x) * pixel_position.x / (texture_resolution.x - 1),
+			-frame_dimension.y / 2.0f + (frame_dimension.y) * pixel_position.y / (texture_resolution.y - 1),
+			-frame_dimension.z);
+		return result;
+	}
+
+	/*
+	 * Basis change matrix from view to grid space
+	 */
+	__device__ __host__ inline glm::mat3x3 viewToGridMatrix(glm::vec3 const& camera_forward)
+	{
+		glm::vec3 u, v, w;
+		w = -camera_forward;
+		u = glm::normalize(glm::cross(glm::vec3(0, 100, 0), w));
+		v = glm::cross(w, u);
+		return glm::mat3x3(u, v, w);
+	}
+}
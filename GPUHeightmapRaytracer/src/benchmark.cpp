@@ -0,0 +1,606 @@
+/*
+ * Benchmark of the traversal, the ingest, the point buffer assembly and the point data generation
+ * Built with the shared sources of the raytracer (HeightmapRaytracer.cpp) and of the generator (Generator.cpp)
+ * Every measurement is written to a JSON file so that runs of different builds and machines can be compared
+ *
+ * Usage: Benchmark [--output <file>] [--dataset <file or directory in ../Data>] [--camera-path <file>] [--repetitions <n>] [--generator-size <n>]
+ * The ingest benchmark only runs with a dataset and the camera path benchmark with a path recorded by the viewer ('c' or --record),
+ * every other benchmark runs on synthetic inputs
+ *
+ * Regression mode: Benchmark --regression [--references <directory>] [--update-references] [--tolerance <n>] [--max-differing <ratio>] [--max-slowdown <ratio>]
+ * Renders the standard views of the synthetic terrain with the host traversal and compares them with reference images and a timing baseline
+ * The references and the baseline are versioned in GPUHeightmapRaytracer/regression, the baseline holds the medians of the build and machine
+ * that wrote it and --max-slowdown is the only slack, rewrite it with --update-references before gating another machine or compiler
+ * The images tolerate the rounding differences of other compilers, views without a baseline entry only report their time
+ * The exit code is the number of failures
+ */
+#include "HeightmapRaytracer.h"
+#include "Traversal.cuh"
+#include "../../PointdataGenerator/Generator.h"
+
+#include <random>
+#include <functional>
+#include <sstream>
+#include <map>
+
+
+//============================
+//		BENCHMARK VARIABLES
+//============================
+
+/*
+ * A measurement, throughput is items per second, extra holds further JSON fields
+ */
+struct BenchmarkResult
+{
+	std::string name;
+	std::string unit;
+	double seconds; // Median over the repetitions
+	double items;
+	std::string extra;
+};
+std::vector<BenchmarkResult> benchmark_results;
+std::string benchmark_output_file = "benchmark.json";
+std::string benchmark_dataset; // Empty skips the ingest benchmark
+std::string benchmark_camera_path; // Empty skips the camera path benchmark
+int benchmark_repetitions = 5;
+int generator_size = 1024; // Grid size of the generator benchmark, a power of two
+int prepare_offset_step = 1; // Coarsest cells between the benchmarked camera offsets
+const unsigned int synthetic_seed = 2017;
+
+// Standard view set, positions are relative to the center of the point buffer
+struct BenchmarkView
+{
+	const char* name;
+	glm::vec3 offset;
+	glm::vec3 forward;
+};
+const BenchmarkView benchmark_views[] =
+{
+	{ "top_down", glm::vec3(0, 600, 0), glm::vec3(0, -1, 0.05f) },
+	{ "oblique", glm::vec3(0, 250, 0), glm::vec3(0, -.9f, 1) },
+	{ "grazing", glm::vec3(0, 120, 0), glm::vec3(0, -.08f, 1) },
+	{ "horizon", glm::vec3(0, 200, 0), glm::vec3(1, .02f, 1) },
+	{ "buffer_edge", glm::vec3(1900, 180, 1900), glm::vec3(1, -.3f, 1) }
+};
+glm::ivec2 benchmark_view_resolution(480, 270);
+
+// Regression mode
+bool regression_mode = false;
+bool regression_update = false; // Write the references and the baseline instead of comparing
+std::string regression_directory = "regression"; // Versioned references, relative to the project directory Visual Studio runs in
+glm::ivec2 regression_resolution(320, 180);
+int regression_tolerance = 8; // Largest channel difference of a matching pixel
+float regression_max_differing = .002f; // Ratio of the pixels of a view allowed to differ, rays that graze an edge may hit another cell
+float regression_max_slowdown = .2f; // Ratio a view may be slower than its baseline
+
+// Traversal totals of a rendered view
+struct ViewTotals
+{
+	long long iterations = 0, descents = 0, ascents = 0, hits = 0;
+};
+
+// Synthetic section shared by every slot of the ring
+float* synthetic_point_section;
+CudaSpace::PackedColor* synthetic_color_section;
+
+
+//============================
+//		BENCHMARK FUNCTIONS
+//============================
+
+/*
+ * Time fn benchmark_repetitions times and keep the median
+ */
+BenchmarkResult& measure(std::string const& name, std::string const& unit, double items, std::function<void()> const& fn, std::string const& extra = "")
+{
+	std::vector<double> times;
+	for (int i = 0; i < benchmark_repetitions; i++)
+	{
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		fn();
+		times.push_back(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+	}
+	std::sort(times.begin(), times.end());
+	BenchmarkResult result = { name, unit, times[times.size() / 2], items, extra };
+	benchmark_results.push_back(result);
+	printf("%-40s %12.3f ms %14.0f %s/s\n", name.c_str(), result.seconds * 1000, result.seconds > 0 ? items / result.seconds : 0.0, unit.c_str());
+	return benchmark_results.back();
+}
+
+/*
+ * Deterministic terrain of rolling hills with some high frequency detail, in finest cells
+ */
+float syntheticHeight(int x, int y)
+{
+	return glm::max(0.f, 100.f + 60.f * glm::sin(x * .0071f) * glm::cos(y * .0053f) + 25.f * glm::sin((x + 2 * y) * .031f) + 10.f * glm::sin(x * .19f) * glm::sin(y * .23f));
+}
+
+/*
+ * Fill the ring with the synthetic section without loaders, every slot shares it and is complete
+ */
+void setupSyntheticRing()
+{
+	int count = stride_x * point_buffer_resolution.x * point_buffer_resolution.y;
+	synthetic_point_section = new float[count]();
+	synthetic_color_section = new CudaSpace::PackedColor[count]();
+	for (int y = 0; y < LOD_resolutions[0]; y++)
+		for (int x = 0; x < LOD_resolutions[0]; x++)
+		{
+			float height = syntheticHeight(x, y);
+			unsigned char shade = static_cast<unsigned char>(glm::min(height, 255.f));
+			synthetic_point_section[LOD_indexes[0] + x + y * LOD_resolutions[0]] = height;
+			synthetic_color_section[LOD_indexes[0] + x + y * LOD_resolutions[0]] = CudaSpace::packColor(CudaSpace::Color(shade, static_cast<unsigned char>(255 - shade), static_cast<unsigned char>(64)));
+		}
+	buildMaxPyramid(synthetic_point_section);
+	buildColorPyramid(synthetic_point_section, synthetic_color_section);
+	max_height = 200;
+
+	section_ring_count = 1;
+	SectionRing& ring = section_rings[0];
+	ring.scale = 1;
+	for (int x = 0; x < point_sections_size; x++)
+		for (int y = 0; y < point_sections_size; y++)
+		{
+			ring.point_sections_origins[x][y] = glm::vec2(x, y) * static_cast<float>(LOD_resolutions[0]);
+			ring.point_sections[x][y] = synthetic_point_section;
+			ring.color_sections[x][y] = synthetic_color_section;
+			ring.section_state[x][y] = new std::atomic<SectionState>(SectionState::Complete);
+			ring.section_valid_LOD[x][y] = new std::atomic<int>(0);
+			ring.thread_pool[x][y] = nullptr;
+		}
+	ring.h_point_buffer = new float[count];
+	ring.h_color_map = new CudaSpace::PackedColor[count];
+
+	/*The rays of the host builds traverse the host point buffer*/
+	setupGridPyramid(grids[0], LOD_resolutions[0], LOD_levels, ring.scale);
+	grids[0].heights = ring.h_point_buffer;
+	grids[0].colors = ring.h_color_map;
+	grid_count = 1;
+}
+
+/*
+ * Camera position whose point buffer starts offset coarsest cells into the second section of the ring
+ */
+glm::vec3 bufferCameraPosition(glm::ivec2 offset)
+{
+	float coarsest_cell = glm::pow(2.f, LOD_levels - 1);
+	glm::vec2 position = glm::vec2(LOD_resolutions[0]) * 1.5f + glm::vec2(offset) * coarsest_cell + .5f;
+	return glm::vec3(position.x, 0, position.y);
+}
+
+/*
+ * Cast the rays of a camera through the host point buffer like the kernel does
+ * image receives RGB values if given, totals receives the traversal totals if given
+ */
+void renderCamera(glm::vec3 camera, glm::vec3 forward, glm::ivec2 resolution, unsigned char* image, ViewTotals* totals)
+{
+	glm::mat3x3 pixel_to_grid_matrix = CudaSpace::viewToGridMatrix(glm::normalize(forward));
+	CudaSpace::TraversalParameters parameters = { use_color_map, max_height, frame_dimension.x / resolution.x / frame_dimension.z, grids, grid_count };
+
+	for (int y = 0; y < resolution.y; y++)
+		for (int x = 0; x < resolution.x; x++)
+		{
+			CudaSpace::Color color(static_cast<unsigned char>(200), static_cast<unsigned char>(200), static_cast<unsigned char>(200));
+			CudaSpace::TraversalCounters ray_counters;
+			glm::vec3 ray_direction = pixel_to_grid_matrix * CudaSpace::viewToGridSpace(glm::ivec2(x, y), frame_dimension, resolution);
+			glm::vec3 ray_position = ray_direction + camera;
+			ray_direction = glm::normalize(ray_direction);
+			CudaSpace::castRay(parameters, ray_position, ray_direction, color, ray_counters);
+
+			if (image != nullptr)
+			{
+				int pixel = (x + y * resolution.x) * 3;
+				image[pixel] = color.r;
+				image[pixel + 1] = color.g;
+				image[pixel + 2] = color.b;
+			}
+			if (totals != nullptr)
+			{
+				totals->iterations += ray_counters.iterations;
+				totals->descents += ray_counters.descents;
+				totals->ascents += ray_counters.ascents;
+				totals->hits += ray_counters.grid >= 0 ? 1 : 0;
+			}
+		}
+}
+
+/*
+ * Render a view of the standard set, its offset is relative to the center of the point buffer
+ */
+void renderView(BenchmarkView const& view, glm::ivec2 resolution, unsigned char* image, ViewTotals* totals)
+{
+	glm::vec3 camera = glm::vec3(grids[0].origin.x, 0, grids[0].origin.y) + glm::vec3(LOD_resolutions[0] / 2.f, 0, LOD_resolutions[0] / 2.f) + view.offset;
+	renderCamera(camera, view.forward, resolution, image, totals);
+}
+
+/*
+ * preparePointBuffer() for every offset of the camera in the coarsest cells of a section
+ */
+void benchmarkPreparePointBuffer()
+{
+	double bytes = static_cast<double>(sectionBytes());
+	for (int y = 0; y < point_buffer_resolution.y; y += prepare_offset_step)
+		for (int x = 0; x < point_buffer_resolution.x; x += prepare_offset_step)
+		{
+			camera_position = bufferCameraPosition(glm::ivec2(x, y));
+			measure("preparePointBuffer/offset_" + std::to_string(x) + "_" + std::to_string(y), "bytes", bytes,
+				[] { preparePointBuffer(section_rings[0], grids[0]); });
+		}
+}
+
+/*
+ * CPU castRay() over the standard view set, the point buffer is centered in the ring
+ */
+void benchmarkCastRay()
+{
+	camera_position = bufferCameraPosition(point_buffer_resolution / 2);
+	preparePointBuffer(section_rings[0], grids[0]);
+	double rays = static_cast<double>(benchmark_view_resolution.x) * benchmark_view_resolution.y;
+	for (BenchmarkView const& view : benchmark_views)
+	{
+		ViewTotals totals;
+		renderView(view, benchmark_view_resolution, nullptr, &totals);
+		std::ostringstream extra;
+		extra << "\"iterations_per_ray\": " << totals.iterations / rays << ", \"descents_per_ray\": " << totals.descents / rays
+			<< ", \"ascents_per_ray\": " << totals.ascents / rays << ", \"hit_ratio\": " << totals.hits / rays;
+		measure(std::string("castRay/") + view.name, "rays", rays,
+			[&view] { renderView(view, benchmark_view_resolution, nullptr, nullptr); }, extra.str());
+	}
+}
+
+/*
+ * preparePointBuffer() and castRay() for every frame of the camera path in benchmark_camera_path
+ * Every slot of the synthetic ring holds the same section, so the positions are moved by whole sections into the second section
+ * of the ring without changing the view, the recorded heights and directions are kept as they are
+ * The median is over whole replays of the path, the frame percentiles are those of the last replay
+ */
+void benchmarkCameraPath()
+{
+	if (benchmark_camera_path.empty())
+		return;
+	camera_path_file = benchmark_camera_path;
+	if (!loadCameraPath())
+		return;
+	float section_extent = static_cast<float>(LOD_resolutions[0]);
+	std::vector<glm::vec3> positions;
+	for (CameraPathFrame const& frame : camera_path)
+	{
+		glm::vec2 position(frame.position.x, frame.position.z);
+		position = position - glm::floor(position / section_extent) * section_extent + section_extent;
+		positions.push_back(glm::vec3(position.x, frame.position.y, position.y));
+	}
+
+	double rays = static_cast<double>(benchmark_view_resolution.x) * benchmark_view_resolution.y * positions.size();
+	ViewTotals totals;
+	for (std::size_t i = 0; i < positions.size(); i++)
+	{
+		camera_position = positions[i];
+		preparePointBuffer(section_rings[0], grids[0]);
+		renderCamera(positions[i], camera_path[i].forward, benchmark_view_resolution, nullptr, &totals);
+	}
+
+	std::vector<double> frame_seconds(positions.size());
+	BenchmarkResult& result = measure("cameraPath/frames_" + std::to_string(positions.size()), "frames", static_cast<double>(positions.size()), [&]
+	{
+		for (std::size_t i = 0; i < positions.size(); i++)
+		{
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			camera_position = positions[i];
+			preparePointBuffer(section_rings[0], grids[0]);
+			renderCamera(positions[i], camera_path[i].forward, benchmark_view_resolution, nullptr, nullptr);
+			frame_seconds[i] = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		}
+	});
+	std::sort(frame_seconds.begin(), frame_seconds.end());
+	std::ostringstream extra;
+	extra << "\"frame_p50_seconds\": " << frame_seconds[frame_seconds.size() / 2] << ", \"frame_p95_seconds\": " << frame_seconds[frame_seconds.size() * 95 / 100]
+		<< ", \"frame_max_seconds\": " << frame_seconds.back() << ", \"iterations_per_ray\": " << totals.iterations / rays << ", \"hit_ratio\": " << totals.hits / rays;
+	result.extra = extra.str();
+}
+
+/*
+ * calculateExitPointAndEdge() and testIntersection() per LOD over random rays in the mirrored grid space
+ * Rising and falling rays take different branches of the intersection test
+ */
+void benchmarkTraversalSteps()
+{
+	const int samples = 1 << 20;
+	std::default_random_engine generator(synthetic_seed);
+	std::uniform_real_distribution<float> position(0, static_cast<float>(LOD_resolutions[0]) - 1), height(0, max_height), direction(.01f, 1);
+	std::vector<glm::vec3> entries(samples), directions(samples), exits(samples);
+	for (int i = 0; i < samples; i++)
+	{
+		entries[i] = glm::vec3(position(generator), height(generator), position(generator));
+		directions[i] = glm::normalize(glm::vec3(direction(generator), direction(generator) * 2 - 1, direction(generator)));
+	}
+
+	camera_position = bufferCameraPosition(point_buffer_resolution / 2);
+	preparePointBuffer(section_rings[0], grids[0]);
+	for (int LOD = 0; LOD < LOD_levels; LOD++)
+	{
+		/*The checksums keep the results alive and tell whether the builds compute the same steps*/
+		long long checksum = 0;
+		BenchmarkResult& exit_result = measure("calculateExitPointAndEdge/LOD_" + std::to_string(LOD), "steps", samples, [&, LOD]
+		{
+			checksum = 0;
+			for (int i = 0; i < samples; i++)
+			{
+				int edge;
+				CudaSpace::calculateExitPointAndEdge(entries[i], directions[i], exits[i], edge, LOD);
+				checksum += edge;
+			}
+		});
+		exit_result.extra = "\"checksum\": " + std::to_string(checksum);
+
+		for (int rising = 0; rising < 2; rising++)
+		{
+			int hits = 0;
+			BenchmarkResult& intersection_result = measure("testIntersection/LOD_" + std::to_string(LOD) + (rising ? "_rising" : "_falling"), "tests", samples, [&, LOD, rising]
+			{
+				hits = 0;
+				for (int i = 0; i < samples; i++)
+				{
+					glm::vec3 entry = entries[i], exit = exits[i], ray_direction = directions[i];
+					int test_LOD = LOD;
+					if ((ray_direction.y >= 0) != (rising == 1))
+						ray_direction.y = -ray_direction.y;
+					hits += CudaSpace::testIntersection(grids[0], entry, exit, ray_direction, false, false, test_LOD) ? 1 : 0;
+				}
+			});
+			intersection_result.extra = "\"hit_ratio\": " + std::to_string(static_cast<double>(hits) / samples);
+		}
+	}
+}
+
+/*
+ * loadLASToSection() on the calling thread for the 2x2 sections around the center of the dataset
+ */
+void benchmarkIngest()
+{
+	if (benchmark_dataset.empty())
+		return;
+	point_cloud_file = benchmark_dataset;
+	readLASHeader(point_cloud_file);
+	glm::vec2 section_extent = glm::vec2(static_cast<float>(LOD_resolutions[0]));
+	glm::ivec2 center_tile = glm::ivec2(glm::floor(boundaries / 2.f / section_extent));
+	int count = stride_x * point_buffer_resolution.x * point_buffer_resolution.y;
+
+	for (int y = 0; y < 2; y++)
+		for (int x = 0; x < 2; x++)
+		{
+			glm::ivec2 tile = center_tile + glm::ivec2(x, y) - glm::ivec2(1, 1);
+			if (tile.x < 0 || tile.y < 0)
+				continue;
+			glm::vec2 origin = glm::vec2(tile) * section_extent;
+			SectionStatistics statistics;
+			measure("loadLASToSection/tile_" + std::to_string(tile.x) + "_" + std::to_string(tile.y), "points", 0, [&]
+			{
+				float* point_section = new float[count]();
+				CudaSpace::PackedColor* color_section = new CudaSpace::PackedColor[count]();
+				std::atomic<SectionState>* state = new std::atomic<SectionState>(SectionState::Loading);
+				std::atomic<int>* valid_LOD = new std::atomic<int>(LOD_levels - 1);
+				loadLASToSection(origin, 1, state, valid_LOD, point_section, color_section);
+				delete[] point_section;
+				delete[] color_section;
+				delete state;
+				delete valid_LOD;
+				std::lock_guard<std::mutex> lock(section_statistics_mutex);
+				statistics = section_statistics.back();
+			});
+
+			/*The points are only known once a load has run*/
+			BenchmarkResult& result = benchmark_results.back();
+			result.items = static_cast<double>(statistics.points_read);
+			std::ostringstream extra;
+			extra << "\"points_accepted\": " << statistics.points_accepted << ", \"bytes_read\": " << static_cast<long long>(statistics.bytes_read)
+				<< ", \"cpu_seconds\": " << statistics.cpu_seconds;
+			result.extra = extra.str();
+		}
+}
+
+/*
+ * Diamond-square grid generation of the point data generator
+ */
+void benchmarkGenerator()
+{
+	GRID_SIZE = generator_size + 1;
+	measure("diamondSquare/size_" + std::to_string(generator_size), "points", static_cast<double>(GRID_SIZE) * GRID_SIZE,
+		[] { diamondSquare(1, synthetic_seed); });
+}
+
+/*
+ * Write an RGB image as binary PPM, rows from the bottom like the texture
+ */
+bool writePPM(std::string const& filename, glm::ivec2 resolution, std::vector<unsigned char> const& image)
+{
+	std::ofstream ofs(filename, std::ios::binary);
+	if (!ofs.is_open())
+		return false;
+	ofs << "P6\n" << resolution.x << " " << resolution.y << "\n255\n";
+	for (int y = resolution.y - 1; y >= 0; y--)
+		ofs.write(reinterpret_cast<const char*>(&image[y * resolution.x * 3]), resolution.x * 3);
+	return true;
+}
+
+bool readPPM(std::string const& filename, glm::ivec2 resolution, std::vector<unsigned char>& image)
+{
+	std::ifstream ifs(filename, std::ios::binary);
+	std::string magic;
+	int width, height, max_value;
+	if (!(ifs >> magic >> width >> height >> max_value) || magic != "P6" || width != resolution.x || height != resolution.y || max_value != 255)
+		return false;
+	ifs.get();
+	image.resize(resolution.x * resolution.y * 3);
+	for (int y = resolution.y - 1; y >= 0; y--)
+		ifs.read(reinterpret_cast<char*>(&image[y * resolution.x * 3]), resolution.x * 3);
+	return static_cast<bool>(ifs);
+}
+
+/*
+ * Baseline of the regression timings, one "name seconds" pair per line
+ */
+std::map<std::string, double> readTimingBaseline(std::string const& filename)
+{
+	std::map<std::string, double> baseline;
+	std::ifstream ifs(filename);
+	std::string name;
+	double seconds;
+	while (ifs >> name >> seconds)
+		baseline[name] = seconds;
+	return baseline;
+}
+
+/*
+ * Render the views of the standard set with height and map colors and compare them with the reference images and timings
+ * A pixel differs when a channel is further than regression_tolerance off, a view fails when more than regression_max_differing of its pixels do
+ * A view also fails when its median time exceeds the baseline by more than regression_max_slowdown
+ * With regression_update the references and the baseline are written instead
+ * Returns the number of failures
+ */
+int runRegression()
+{
+	camera_position = bufferCameraPosition(point_buffer_resolution / 2);
+	preparePointBuffer(section_rings[0], grids[0]);
+	std::string baseline_file = regression_directory + "/timing_baseline.txt";
+	std::map<std::string, double> baseline = readTimingBaseline(baseline_file);
+	std::ofstream baseline_update;
+	if (regression_update)
+	{
+		CreateDirectoryA(regression_directory.c_str(), nullptr);
+		baseline_update.open(baseline_file);
+	}
+
+	int failures = 0;
+	std::vector<unsigned char> image(regression_resolution.x * regression_resolution.y * 3), reference;
+	for (int color = 0; color < 2; color++)
+		for (BenchmarkView const& view : benchmark_views)
+		{
+			use_color_map = color == 1;
+			std::string name = std::string(view.name) + (use_color_map ? "_color" : "_height");
+			std::string reference_file = regression_directory + "/" + name + ".ppm";
+			double rays = static_cast<double>(regression_resolution.x) * regression_resolution.y;
+			double seconds = measure("regression/" + name, "rays", rays, [&view, &image] { renderView(view, regression_resolution, image.data(), nullptr); }).seconds;
+
+			if (regression_update)
+			{
+				writePPM(reference_file, regression_resolution, image);
+				baseline_update << name << " " << seconds << std::endl;
+				continue;
+			}
+
+			/*Compare the image*/
+			if (!readPPM(reference_file, regression_resolution, reference))
+			{
+				std::cout << "FAIL " << name << ": missing reference " << reference_file << ", run with --update-references" << std::endl;
+				failures++;
+				continue;
+			}
+			int differing = 0, max_difference = 0;
+			for (std::size_t pixel = 0; pixel < image.size(); pixel += 3)
+			{
+				int difference = 0;
+				for (int channel = 0; channel < 3; channel++)
+					difference = glm::max(difference, glm::abs(image[pixel + channel] - reference[pixel + channel]));
+				max_difference = glm::max(max_difference, difference);
+				if (difference > regression_tolerance)
+					differing++;
+			}
+			if (differing > regression_max_differing * rays)
+			{
+				std::cout << "FAIL " << name << ": " << differing << " pixels differ, up to " << max_difference << std::endl;
+				writePPM(regression_directory + "/" + name + ".actual.ppm", regression_resolution, image);
+				failures++;
+			}
+
+			/*Compare the timing*/
+			auto expected = baseline.find(name);
+			if (expected == baseline.end())
+				std::cout << "No timing baseline for " << name << std::endl;
+			else if (seconds > expected->second * (1 + regression_max_slowdown))
+			{
+				std::cout << "FAIL " << name << ": " << seconds * 1000 << " ms against a baseline of " << expected->second * 1000 << " ms" << std::endl;
+				failures++;
+			}
+		}
+	use_color_map = false;
+
+	if (regression_update)
+		std::cout << "References written to " << regression_directory << std::endl;
+	else
+		std::cout << (failures == 0 ? "Regression passed" : "Regression failed with " + std::to_string(failures) + " failures") << std::endl;
+	return failures;
+}
+
+/*
+ * Write every measurement as JSON
+ */
+void writeBenchmarkResults()
+{
+	std::ofstream json(benchmark_output_file);
+	json << "{" << std::endl << "  \"repetitions\": " << benchmark_repetitions << "," << std::endl << "  \"benchmarks\": [" << std::endl;
+	for (std::size_t i = 0; i < benchmark_results.size(); i++)
+	{
+		BenchmarkResult const& result = benchmark_results[i];
+		json << "    { \"name\": \"" << result.name << "\", \"unit\": \"" << result.unit << "\", \"seconds\": " << result.seconds
+			<< ", \"items\": " << result.items << ", \"throughput\": " << (result.seconds > 0 ? result.items / result.seconds : 0);
+		if (!result.extra.empty())
+			json << ", " << result.extra;
+		json << " }" << (i + 1 < benchmark_results.size() ? "," : "") << std::endl;
+	}
+	json << "  ]" << std::endl << "}" << std::endl;
+	std::cout << "Results written to " << benchmark_output_file << std::endl;
+}
+
+
+//============================
+//			MAIN
+//============================
+int main(int argc, char** argv)
+{
+	for (int i = 1; i < argc; i++)
+	{
+		std::string argument = argv[i];
+		if (argument == "--output" && i + 1 < argc)
+			benchmark_output_file = argv[++i];
+		else if (argument == "--dataset" && i + 1 < argc)
+			benchmark_dataset = argv[++i];
+		else if (argument == "--camera-path" && i + 1 < argc)
+			benchmark_camera_path = argv[++i];
+		else if (argument == "--repetitions" && i + 1 < argc)
+			benchmark_repetitions = glm::max(1, atoi(argv[++i]));
+		else if (argument == "--generator-size" && i + 1 < argc)
+			generator_size = atoi(argv[++i]);
+		else if (argument == "--regression")
+			regression_mode = true;
+		else if (argument == "--references" && i + 1 < argc)
+			regression_directory = argv[++i];
+		else if (argument == "--update-references")
+			regression_update = true;
+		else if (argument == "--tolerance" && i + 1 < argc)
+			regression_tolerance = atoi(argv[++i]);
+		else if (argument == "--max-differing" && i + 1 < argc)
+			regression_max_differing = static_cast<float>(atof(argv[++i]));
+		else if (argument == "--max-slowdown" && i + 1 < argc)
+			regression_max_slowdown = static_cast<float>(atof(argv[++i]));
+		else
+			std::cout << "Unknown argument " << argument << std::endl;
+	}
+
+	initializeLODLayout();
+	setupSyntheticRing();
+	if (regression_mode)
+	{
+		int failures = runRegression();
+		writeBenchmarkResults();
+		return failures;
+	}
+	benchmarkPreparePointBuffer();
+	benchmarkCastRay();
+	benchmarkCameraPath();
+	benchmarkTraversalSteps();
+	benchmarkGenerator();
+	benchmarkIngest();
+	writeBenchmarkResults();
+	return 0;
+}
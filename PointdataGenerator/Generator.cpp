@@ -0,0 +1,325 @@
+#include "Generator.h"
+
+int GRID_SIZE = 1024 + 1;
+
+// LAS output
+double las_scale = 0.001; // Coordinate resolution of the point records
+bool write_color = false; // Synthetic RGB from the height, point format 2 instead of 0
+bool write_classification = false; // Every point classified as ground instead of never classified
+bool write_compressed = false; // LAZ, needs a liblas built with LASzip
+
+// Tiled generation, each tile is computed on its own from seeded fractal noise and written to its own file
+int tile_size = 0; // Points per tile side, 0 generates a single grid with diamond-square
+int tile_count = 4; // Tiles per side
+int fbm_octaves = 10;
+float fbm_wavelength = 2048; // Grid cells of the coarsest octave
+float fbm_amplitude = 5; // Height range before scaling, close to the diamond-square range
+
+/***********************************
+METHODS
+************************************/
+/*
+ * Every diamond and every square pass only reads points of earlier passes, so the rows of a pass run in parallel
+ * Each row draws from its own generator seeded by the seed, the pass and the row, the result does not depend on the thread count
+ */
+HeightGrid diamondSquare(float startDeviation, unsigned int seed)
+{
+	std::default_random_engine gen(seed);
+	std::uniform_real_distribution<float> dist(0, startDeviation);
+
+	//Initialize grid
+	std::cout << "Initializing grid..." << std::endl;
+	HeightGrid result(GRID_SIZE);
+
+	//Set random values at the corners
+	result.at(0, 0) = dist(gen);
+	result.at(0, GRID_SIZE - 1) = dist(gen);
+	result.at(GRID_SIZE - 1, 0) = dist(gen);
+	result.at(GRID_SIZE - 1, GRID_SIZE - 1) = dist(gen);
+
+	//Diamond-Square Loop
+	std::cout << "Performing Diamond-Square Algorithm..." << std::endl;
+	int count = 1;
+	for (int half = (GRID_SIZE - 1) / 2; half > 0; half /= 2)
+	{
+		//Centers of the squares
+		parallelRows(half, 2 * half, GRID_SIZE, [&](int y)
+		{
+			std::seed_seq row_seed = { seed, static_cast<unsigned int>(count), 0u, static_cast<unsigned int>(y) };
+			std::default_random_engine row_gen(row_seed);
+			for (int x = half; x < GRID_SIZE; x += 2 * half)
+				diamondStep(x, y, half, rowRoughness(row_gen, count), &result);
+		});
+
+		//Edge midpoints, offset by half a step on every other row
+		parallelRows(0, half, GRID_SIZE, [&](int y)
+		{
+			std::seed_seq row_seed = { seed, static_cast<unsigned int>(count), 1u, static_cast<unsigned int>(y) };
+			std::default_random_engine row_gen(row_seed);
+			for (int x = (y / half) % 2 == 0 ? half : 0; x < GRID_SIZE; x += 2 * half)
+				squareStep(x, y, half, rowRoughness(row_gen, count), &result);
+		});
+		++count;
+	}
+
+	return result;
+}
+
+float rowRoughness(std::default_random_engine& gen, int count)
+{
+	std::uniform_real_distribution<float> dist(0, 1);
+	return pow(dist(gen), count);
+}
+
+/*
+ * Run row(y) for y = first, first + step, ... below end, the rows are split in contiguous blocks over the hardware threads
+ */
+void parallelRows(int first, int step, int end, std::function<void(int)> const& row)
+{
+	int rows = (end - first + step - 1) / step;
+	int thread_count = (std::max)(1, (std::min)(rows / 16, static_cast<int>(std::thread::hardware_concurrency())));
+	if (thread_count <= 1)
+	{
+		for (int y = first; y < end; y += step)
+			row(y);
+		return;
+	}
+
+	std::vector<std::thread> threads;
+	for (int t = 0; t < thread_count; t++)
+		threads.push_back(std::thread([=, &row]
+		{
+			for (int i = rows * t / thread_count; i < rows * (t + 1) / thread_count; i++)
+				row(first + i * step);
+		}));
+	for (auto& thread : threads)
+		thread.join();
+}
+
+void diamondStep(int x, int y, int stepSize, float r, HeightGrid *grid)
+{
+	grid->at(x, y) =
+		(grid->at(x + stepSize, y + stepSize)
+			+ grid->at(x - stepSize, y + stepSize)
+			+ grid->at(x + stepSize, y - stepSize)
+			+ grid->at(x - stepSize, y - stepSize)) / 4 + r;
+}
+
+void squareStep(int x, int y, int stepSize, float r, HeightGrid *grid)
+{
+	float left = 0, right = 0, top = 0, bottom = 0;
+	int count = 0;
+	if (x > 0)
+	{
+		left = grid->at(x - stepSize, y);
+		count++;
+	}
+	if (x < GRID_SIZE - 1)
+	{
+		right = grid->at(x + stepSize, y);
+		count++;
+	}
+	if (y > 0)
+	{
+		top = grid->at(x, y - stepSize);
+		count++;
+	}
+	if (y < GRID_SIZE - 1)
+	{
+		bottom = grid->at(x, y + stepSize);
+		count++;
+	}
+
+	grid->at(x, y) = (left + right + top + bottom)/count + r;
+}
+
+/*
+ * The grid positions are implicit, only the heights receive noise
+ */
+void addNoise(HeightGrid* grid, float noise)
+{
+	std::default_random_engine eng;
+	std::uniform_real_distribution<float> dist(-noise, noise);
+	for (auto& height : grid->heights)
+		height += dist(eng);
+}
+
+void scaleData(HeightGrid* grid, float factor)
+{
+	parallelRows(0, 1, grid->size, [grid, factor](int y)
+	{
+		for (int x = 0; x < grid->size; x++)
+			grid->at(x, y) *= factor;
+	});
+}
+
+/*
+ * Hash of a lattice point to [0, 1), the same for every tile that touches it
+ */
+float latticeValue(int x, int y, unsigned int seed)
+{
+	uint32_t h = seed * 0x9E3779B9u ^ static_cast<uint32_t>(x) * 0x85EBCA6Bu ^ static_cast<uint32_t>(y) * 0xC2B2AE35u;
+	h ^= h >> 16;
+	h *= 0x7FEB352Du;
+	h ^= h >> 15;
+	h *= 0x846CA68Bu;
+	h ^= h >> 16;
+	return h / 4294967296.f;
+}
+
+/*
+ * Smoothly interpolated lattice values
+ */
+float valueNoise(double x, double y, unsigned int seed)
+{
+	double fx = floor(x), fy = floor(y);
+	int ix = static_cast<int>(fx), iy = static_cast<int>(fy);
+	float tx = static_cast<float>(x - fx), ty = static_cast<float>(y - fy);
+	tx = tx * tx * (3 - 2 * tx);
+	ty = ty * ty * (3 - 2 * ty);
+	float top = latticeValue(ix, iy, seed) + (latticeValue(ix + 1, iy, seed) - latticeValue(ix, iy, seed)) * tx;
+	float bottom = latticeValue(ix, iy + 1, seed) + (latticeValue(ix + 1, iy + 1, seed) - latticeValue(ix, iy + 1, seed)) * tx;
+	return top + (bottom - top) * ty;
+}
+
+/*
+ * Fractal sum of value noise octaves in [0, 1], a pure function of the position so tiles agree on their borders
+ */
+float fbmHeight(double x, double y, unsigned int seed)
+{
+	float height = 0, amplitude = 1, total = 0;
+	double frequency = 1 / static_cast<double>(fbm_wavelength);
+	for (int octave = 0; octave < fbm_octaves; octave++)
+	{
+		height += amplitude * valueNoise(x * frequency, y * frequency, seed + octave * 0x632BE5ABu);
+		total += amplitude;
+		amplitude *= .5f;
+		frequency *= 2;
+	}
+	return height / total;
+}
+
+/*
+ * Heights of the tile starting at the given grid position, scaled by the factor
+ */
+HeightGrid generateTile(int origin_x, int origin_y, unsigned int seed, float factor)
+{
+	HeightGrid tile(tile_size);
+	for (int y = 0; y < tile_size; y++)
+		for (int x = 0; x < tile_size; x++)
+			tile.at(x, y) = fbmHeight(origin_x + x, origin_y + y, seed) * fbm_amplitude * factor;
+	return tile;
+}
+
+/*
+ * Generate and write the tiles on every hardware thread, each thread holds one tile at a time
+ * Tiles do not share points, tile (x, y) covers the grid positions from (x, y) * tile_size
+ */
+void generateTiles(std::string directory, unsigned int seed, float factor)
+{
+	_mkdir(("../Data/" + directory).c_str());
+	std::string extension = write_compressed ? ".laz" : ".las";
+	int tiles = tile_count * tile_count;
+	std::atomic<int> next_tile(0);
+
+	std::vector<std::thread> threads;
+	int thread_count = (std::max)(1, (std::min)(tiles, static_cast<int>(std::thread::hardware_concurrency())));
+	for (int t = 0; t < thread_count; t++)
+		threads.push_back(std::thread([&]
+		{
+			for (int i = next_tile++; i < tiles; i = next_tile++)
+			{
+				int x = i % tile_count, y = i / tile_count;
+				HeightGrid tile = generateTile(x * tile_size, y * tile_size, seed, factor);
+				savePointData(&tile, directory + "/tile_" + std::to_string(x) + "_" + std::to_string(y) + extension,
+					x * tile_size, y * tile_size, 0, fbm_amplitude * factor);
+			}
+		}));
+	for (auto& thread : threads)
+		thread.join();
+}
+
+/*
+ * Gradient from green lowlands over brown slopes to white peaks, in 16 bit LAS color
+ */
+liblas::Color heightColor(float height, float min, float max)
+{
+	float t = max > min ? (height - min) / (max - min) : 0;
+	float low[3] = { 60, 130, 50 }, mid[3] = { 140, 110, 70 }, high[3] = { 245, 245, 245 };
+	float* a = t < .5f ? low : mid;
+	float* b = t < .5f ? mid : high;
+	float f = t < .5f ? t * 2 : t * 2 - 1;
+	return liblas::Color(
+		static_cast<uint16_t>((a[0] + (b[0] - a[0]) * f) * 257),
+		static_cast<uint16_t>((a[1] + (b[1] - a[1]) * f) * 257),
+		static_cast<uint16_t>((a[2] + (b[2] - a[2]) * f) * 257));
+}
+
+/*
+ * Write the grid as a LAS 1.2 file through liblas, one point per grid position, shifted by the origin
+ * The bounds and the point count are known up front, so the header is complete before the first record
+ * Colors span the given height range, or the range of the grid when it is empty
+ * Grids of more points than a LAS 1.2 header can count are rejected instead of written with a truncated count
+ */
+void savePointData(HeightGrid* grid, std::string filename, int origin_x, int origin_y, float color_min, float color_max)
+{
+	if (grid->heights.size() > UINT32_MAX)
+	{
+		std::cout << "Could not write /Data/" << filename << ": " << grid->heights.size() << " points exceed the LAS limit of " << UINT32_MAX << std::endl;
+		return;
+	}
+
+	float min = grid->heights[0], max = grid->heights[0];
+	for (float height : grid->heights)
+	{
+		min = (std::min)(min, height);
+		max = (std::max)(max, height);
+	}
+
+	std::ofstream output("../Data/" + filename, std::ios::out | std::ios::binary);
+	if (!output.is_open())
+	{
+		std::cout << "Could not open /Data/" << filename << std::endl;
+		return;
+	}
+
+	liblas::Header header;
+	header.SetVersionMinor(2);
+	header.SetDataFormatId(write_color ? liblas::ePointFormat2 : liblas::ePointFormat0);
+	header.SetScale(las_scale, las_scale, las_scale);
+	header.SetOffset(0, 0, 0);
+	header.SetMin(origin_x, origin_y, min);
+	header.SetMax(origin_x + grid->size - 1, origin_y + grid->size - 1, max);
+	header.SetPointRecordsCount(static_cast<uint32_t>(grid->heights.size()));
+	header.SetSoftwareId("PointdataGenerator");
+	header.SetCompressed(write_compressed);
+
+	try
+	{
+		liblas::Writer writer(output, header);
+		liblas::Point point(&header);
+		if (color_max <= color_min)
+		{
+			color_min = min;
+			color_max = max;
+		}
+		if (write_classification)
+			point.SetClassification(liblas::Classification(2));
+		for (int y = 0; y < grid->size; y++)
+			for (int x = 0; x < grid->size; x++)
+			{
+				float height = grid->at(x, y);
+				point.SetCoordinates(origin_x + x, origin_y + y, height);
+				if (write_color)
+					point.SetColor(heightColor(height, color_min, color_max));
+				writer.WritePoint(point);
+			}
+	}
+	catch (std::exception const& e)
+	{
+		std::cout << "Could not write /Data/" << filename << ": " << e.what() << std::endl;
+		return;
+	}
+
+	std::cout << "File saved in /Data/" << filename << std::endl;
+}
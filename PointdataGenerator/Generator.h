@@ -0,0 +1,64 @@
+#pragma once
+
+#include <vector>
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <random>
+#include <cmath>
+#include <thread>
+#include <algorithm>
+#include <functional>
+#include <ctime>
+#include <atomic>
+#include <cstdint>
+#include <direct.h>
+#include <liblas/liblas.hpp>
+
+extern int GRID_SIZE;
+
+// LAS output
+extern double las_scale; // Coordinate resolution of the point records
+extern bool write_color; // Synthetic RGB from the height, point format 2 instead of 0
+extern bool write_classification; // Every point classified as ground instead of never classified
+extern bool write_compressed; // LAZ, needs a liblas built with LASzip
+
+// Tiled generation, each tile is computed on its own from seeded fractal noise and written to its own file
+extern int tile_size; // Points per tile side, 0 generates a single grid with diamond-square
+extern int tile_count; // Tiles per side
+extern int fbm_octaves;
+extern float fbm_wavelength; // Grid cells of the coarsest octave
+extern float fbm_amplitude; // Height range before scaling, close to the diamond-square range
+
+/*
+ * Heights of a square grid stored row after row, the x and y of a point are its indexes
+ */
+struct HeightGrid
+{
+	HeightGrid() : size(0) {}
+	HeightGrid(int s) : size(s), heights(static_cast<size_t>(s) * s, 0.f) {}
+
+	float& at(int x, int y) { return heights[static_cast<size_t>(y) * size + x]; }
+	float at(int x, int y) const { return heights[static_cast<size_t>(y) * size + x]; }
+
+	int size;
+	std::vector<float> heights;
+};
+
+HeightGrid diamondSquare(float startDeviation, unsigned int seed);
+void diamondStep(int x, int y, int stepSize, float roughness, HeightGrid *grid);
+void squareStep(int x, int y, int stepSize, float roughness, HeightGrid *grid);
+void parallelRows(int first, int step, int end, std::function<void(int)> const& row);
+float rowRoughness(std::default_random_engine& gen, int count);
+
+void addNoise(HeightGrid* grid, float deviation);
+void scaleData(HeightGrid* grid, float factor);
+
+float latticeValue(int x, int y, unsigned int seed);
+float valueNoise(double x, double y, unsigned int seed);
+float fbmHeight(double x, double y, unsigned int seed);
+HeightGrid generateTile(int origin_x, int origin_y, unsigned int seed, float factor);
+void generateTiles(std::string directory, unsigned int seed, float factor);
+
+liblas::Color heightColor(float height, float min, float max);
+void savePointData(HeightGrid* grid, std::string filename, int origin_x = 0, int origin_y = 0, float color_min = 0, float color_max = 0);